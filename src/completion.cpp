@@ -0,0 +1,203 @@
+#include "completion.hpp"
+#include "word-list.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace wf
+{
+    namespace osk
+    {
+        CompletionTrie::CompletionTrie(const std::string& path)
+        {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if ((fd < 0) || (fstat(fd, &st) < 0))
+            {
+                std::cerr << "Failed to open the completion trie " << path << std::endl;
+                std::exit(-1);
+            }
+
+            size = st.st_size;
+            if (size >= sizeof(trie_header_t))
+                data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+
+            /* The mapping keeps the file alive */
+            close(fd);
+
+            auto header = (const trie_header_t*)data;
+            if ((data == MAP_FAILED) || !header ||
+                std::memcmp(header->magic, TRIE_MAGIC, sizeof(TRIE_MAGIC)) ||
+                (header->node_count == 0) ||
+                (size != sizeof(trie_header_t) +
+                    size_t(header->node_count) * sizeof(trie_node_t)))
+            {
+                std::cerr << "Invalid completion trie " << path << std::endl;
+                std::exit(-1);
+            }
+
+            nodes = (const trie_node_t*)(header + 1);
+            node_count = header->node_count;
+        }
+
+        CompletionTrie::~CompletionTrie()
+        {
+            munmap((void*)data, size);
+        }
+
+        uint32_t CompletionTrie::child(uint32_t node, uint8_t byte) const
+        {
+            if (node >= node_count)
+                return NONE;
+
+            /* Children are checked against the file size, it may be
+             * corrupted without the header noticing */
+            auto& parent = nodes[node];
+            uint32_t end = std::min<uint64_t>(
+                uint64_t(parent.first_child) + parent.child_count, node_count);
+            for (uint32_t i = parent.first_child; i < end; i++)
+            {
+                if (nodes[i].byte == byte)
+                    return i;
+            }
+
+            return NONE;
+        }
+
+        uint32_t CompletionTrie::find_prefix(std::string_view prefix) const
+        {
+            uint32_t node = ROOT;
+            for (size_t i = 0; (i < prefix.size()) && (node != NONE); i++)
+                node = child(node, prefix[i]);
+
+            return node;
+        }
+
+        std::vector<std::string> CompletionTrie::complete(uint32_t node,
+            const std::string& prefix, size_t count) const
+        {
+            std::vector<std::string> words;
+            if (node >= node_count)
+                return words;
+
+            struct item_t
+            {
+                uint32_t rank;
+                uint32_t node;
+                std::string text;
+
+                bool operator < (const item_t& other) const
+                {
+                    return rank > other.rank;
+                }
+            };
+
+            /* Subtrees are visited best rank first, so words come out from
+             * most to least frequent */
+            std::priority_queue<item_t> queue;
+            queue.push({nodes[node].best_rank, node, prefix});
+            while (!queue.empty() && (words.size() < count))
+            {
+                auto item = queue.top();
+                queue.pop();
+
+                auto& current = nodes[item.node];
+                if ((current.byte == 0) && (item.node != ROOT))
+                {
+                    words.push_back(std::move(item.text));
+                    continue;
+                }
+
+                uint32_t end = std::min<uint64_t>(
+                    uint64_t(current.first_child) + current.child_count, node_count);
+                for (uint32_t i = current.first_child; i < end; i++)
+                {
+                    queue.push({nodes[i].best_rank, i, nodes[i].byte ?
+                        item.text + char(nodes[i].byte) : item.text});
+                }
+            }
+
+            return words;
+        }
+
+        bool CompletionTrie::build(const std::vector<std::string>& list,
+            const std::string& path)
+        {
+            /* Only words the keyboard can track are ever looked up */
+            auto words = normalize_words(list);
+
+            struct build_node_t
+            {
+                std::map<uint8_t, uint32_t> children;
+                uint32_t best_rank = UINT32_MAX;
+            };
+
+            std::vector<build_node_t> tree(1);
+            for (uint32_t rank = 0; rank < words.size(); rank++)
+            {
+                const std::string& word = words[rank];
+                uint32_t node = 0;
+                tree[node].best_rank = std::min(tree[node].best_rank, rank);
+
+                /* The terminating 0 is the end of word node */
+                for (size_t i = 0; i <= word.size(); i++)
+                {
+                    uint8_t byte = (i < word.size()) ? word[i] : 0;
+                    auto it = tree[node].children.find(byte);
+                    if (it == tree[node].children.end())
+                    {
+                        uint32_t child = tree.size();
+                        tree[node].children.emplace(byte, child);
+                        tree.emplace_back();
+                        node = child;
+                    } else
+                    {
+                        node = it->second;
+                    }
+
+                    tree[node].best_rank = std::min(tree[node].best_rank, rank);
+                }
+            }
+
+            /* Lay the nodes out breadth first, so that the children of a
+             * node get consecutive indices */
+            std::vector<trie_node_t> nodes(tree.size());
+            std::deque<std::pair<uint32_t, uint32_t>> queue = {{0, 0}};
+            uint32_t next_index = 1;
+            nodes[0] = {0, tree[0].best_rank, 0, 0, 0};
+            while (!queue.empty())
+            {
+                auto [tree_node, index] = queue.front();
+                queue.pop_front();
+
+                auto& children = tree[tree_node].children;
+                nodes[index].first_child = next_index;
+                nodes[index].child_count = children.size();
+                for (auto& [byte, child] : children)
+                {
+                    nodes[next_index] = {0, tree[child].best_rank, 0, byte, 0};
+                    queue.push_back({child, next_index++});
+                }
+            }
+
+            trie_header_t header;
+            std::memcpy(header.magic, TRIE_MAGIC, sizeof(TRIE_MAGIC));
+            header.node_count = nodes.size();
+            header.reserved = 0;
+
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write((const char*)&header, sizeof(header));
+            file.write((const char*)nodes.data(), nodes.size() * sizeof(trie_node_t));
+            return bool(file);
+        }
+    }
+}
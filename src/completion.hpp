@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wf
+{
+    namespace osk
+    {
+        /* A node of a completion trie file, see CompletionTrie */
+        struct trie_node_t
+        {
+            /* Index of the first child, the children of a node are
+             * consecutive and sorted by byte */
+            uint32_t first_child;
+            /* Rank of the most frequent word below, 0 is the most frequent */
+            uint32_t best_rank;
+            uint16_t child_count;
+            /* Label of the edge to this node, 0 marks the end of a word */
+            uint8_t byte;
+            uint8_t reserved;
+        };
+
+        static_assert(sizeof(trie_node_t) == 12,
+            "trie_node_t is part of the file format");
+
+        struct trie_header_t
+        {
+            char magic[8];
+            uint32_t node_count;
+            uint32_t reserved;
+        };
+
+        static constexpr char TRIE_MAGIC[8] = {'W', 'F', 'O', 'S', 'K', 'T', 'R', '1'};
+
+        /**
+         * A byte trie of a word list in a file which is used in place
+         * through mmap(), so loading it takes constant time and its pages
+         * are shared by every process using the same file. The file is in
+         * host byte order and is built by wf-osk-dict.
+         *
+         * Every node records the best rank below it, so the most frequent
+         * completions of a prefix are found with a best-first search which
+         * only visits the nodes leading to them.
+         */
+        class CompletionTrie
+        {
+            const void *data = nullptr;
+            size_t size = 0;
+            const trie_node_t *nodes = nullptr;
+            uint32_t node_count = 0;
+
+            public:
+            static constexpr uint32_t ROOT = 0;
+            static constexpr uint32_t NONE = UINT32_MAX;
+
+            /* Map the file, exits if it is not a valid trie file */
+            CompletionTrie(const std::string& path);
+            ~CompletionTrie();
+            CompletionTrie(const CompletionTrie&) = delete;
+            CompletionTrie& operator = (const CompletionTrie&) = delete;
+
+            /* The child of node for the byte, NONE if there is none */
+            uint32_t child(uint32_t node, uint8_t byte) const;
+            /* The node reached with the prefix from the root, NONE if no
+             * word starts with it */
+            uint32_t find_prefix(std::string_view prefix) const;
+
+            /* The count most frequent words below node, which is reached
+             * with prefix, from most to least frequent */
+            std::vector<std::string> complete(uint32_t node,
+                const std::string& prefix, size_t count) const;
+
+            /* Write a trie file of the words, from most to least frequent,
+             * after normalize_words() */
+            static bool build(const std::vector<std::string>& words,
+                const std::string& path);
+        };
+    }
+}
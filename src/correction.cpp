@@ -0,0 +1,293 @@
+#include "correction.hpp"
+#include "word-list.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace wf
+{
+    namespace osk
+    {
+        /* Deletes of longer words only start within this prefix */
+        static constexpr uint32_t PREFIX_LENGTH = 7;
+        static constexpr uint32_t MAX_DISTANCE = 2;
+        /* Typed words up to this length are corrected by one edit at most */
+        static constexpr size_t SHORT_WORD_LENGTH = 4;
+
+        EditDistance::EditDistance(std::string_view word)
+        {
+            length = std::min(word.size(), MAX_LENGTH);
+            for (size_t i = 0; i < length; i++)
+                match[(uint8_t)word[i]] |= uint64_t(1) << i;
+        }
+
+        int EditDistance::to(std::string_view other) const
+        {
+            if (length == 0)
+                return other.size();
+
+            /* Vertical deltas of the current column, +1 and -1, and the
+             * diagonal zero deltas */
+            uint64_t positive = ~uint64_t(0), negative = 0, zero = 0;
+            uint64_t previous_match = 0;
+            const uint64_t last = uint64_t(1) << (length - 1);
+            int distance = length;
+            for (char c : other)
+            {
+                uint64_t current_match = match[(uint8_t)c];
+                uint64_t transposed = (((~zero) & current_match) << 1) & previous_match;
+                zero = (((current_match & positive) + positive) ^ positive) |
+                    current_match | negative | transposed;
+
+                uint64_t horizontal_positive = negative | ~(zero | positive);
+                uint64_t horizontal_negative = zero & positive;
+                if (horizontal_positive & last)
+                    distance++;
+                else if (horizontal_negative & last)
+                    distance--;
+
+                uint64_t shifted = (horizontal_positive << 1) | 1;
+                negative = shifted & zero;
+                positive = (horizontal_negative << 1) | ~(shifted | zero);
+                previous_match = current_match;
+            }
+
+            return distance;
+        }
+
+        /* FNV-1a, part of the file format */
+        static uint32_t hash_bytes(std::string_view bytes)
+        {
+            uint32_t hash = 2166136261u;
+            for (char c : bytes)
+                hash = (hash ^ (uint8_t)c) * 16777619u;
+
+            return hash;
+        }
+
+        /* The word and the distinct strings obtained by deleting up to
+         * max_distance bytes from it */
+        static std::vector<std::string> get_deletes(std::string_view word,
+            uint32_t max_distance)
+        {
+            std::vector<std::string> deletes = {std::string(word)};
+            size_t level_start = 0;
+            for (uint32_t distance = 1; distance <= max_distance; distance++)
+            {
+                size_t level_end = deletes.size();
+                for (size_t i = level_start; i < level_end; i++)
+                {
+                    for (size_t j = 0; j < deletes[i].size(); j++)
+                    {
+                        std::string shorter = deletes[i];
+                        shorter.erase(j, 1);
+                        deletes.push_back(std::move(shorter));
+                    }
+                }
+
+                level_start = level_end;
+            }
+
+            std::sort(deletes.begin(), deletes.end());
+            deletes.erase(std::unique(deletes.begin(), deletes.end()), deletes.end());
+            return deletes;
+        }
+
+        CorrectionIndex::CorrectionIndex(const std::string& path)
+        {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if ((fd < 0) || (fstat(fd, &st) < 0))
+            {
+                std::cerr << "Failed to open the correction index " << path << std::endl;
+                std::exit(-1);
+            }
+
+            size = st.st_size;
+            if (size >= sizeof(correction_header_t))
+                data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+
+            /* The mapping keeps the file alive */
+            close(fd);
+
+            header = (const correction_header_t*)data;
+            uint64_t expected = 0;
+            if (header && (data != MAP_FAILED))
+            {
+                expected = sizeof(correction_header_t) + 4 * (
+                    uint64_t(header->word_count) + 1 + header->bucket_count + 1 +
+                    header->entry_count) + header->text_size;
+            }
+
+            if (!expected || (expected != size) ||
+                std::memcmp(header->magic, CORRECTION_MAGIC, sizeof(CORRECTION_MAGIC)) ||
+                (header->bucket_count == 0) ||
+                (header->bucket_count & (header->bucket_count - 1)))
+            {
+                std::cerr << "Invalid correction index " << path << std::endl;
+                std::exit(-1);
+            }
+
+            word_offsets = (const uint32_t*)(header + 1);
+            bucket_start = word_offsets + header->word_count + 1;
+            entries = bucket_start + header->bucket_count + 1;
+            text = (const char*)(entries + header->entry_count);
+        }
+
+        CorrectionIndex::~CorrectionIndex()
+        {
+            munmap((void*)data, size);
+        }
+
+        const correction_header_t& CorrectionIndex::get_header() const
+        {
+            return *header;
+        }
+
+        std::string_view CorrectionIndex::get_word(uint32_t id) const
+        {
+            if (id >= header->word_count)
+                return {};
+
+            /* Offsets are clamped, the file is not checked when mapped */
+            uint32_t start = std::min(word_offsets[id], header->text_size);
+            uint32_t end = std::clamp(word_offsets[id + 1], start, header->text_size);
+            return std::string_view(text + start, end - start);
+        }
+
+        std::string_view CorrectionIndex::correct(std::string_view word) const
+        {
+            if (word.empty() || (word.size() > EditDistance::MAX_LENGTH))
+                return {};
+
+            /* Deletes grow exponentially with the distance, do not trust
+             * the file with it */
+            uint32_t max_distance = std::min(header->max_distance, MAX_DISTANCE);
+            if (word.size() <= SHORT_WORD_LENGTH)
+                max_distance = std::min(max_distance, 1u);
+
+            std::vector<uint32_t> candidates;
+            for (auto& deleted : get_deletes(
+                word.substr(0, header->prefix_length), max_distance))
+            {
+                uint32_t bucket = hash_bytes(deleted) & (header->bucket_count - 1);
+                uint32_t first = std::min(bucket_start[bucket], header->entry_count);
+                uint32_t last = std::clamp(bucket_start[bucket + 1], first,
+                    header->entry_count);
+                candidates.insert(candidates.end(), entries + first, entries + last);
+            }
+
+            /* Ids are ranks, so the first of equally close words is the
+             * most frequent one */
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                candidates.end());
+
+            EditDistance distance(word);
+            std::string_view best;
+            int best_distance = max_distance + 1;
+            for (uint32_t id : candidates)
+            {
+                auto candidate = get_word(id);
+                size_t difference = std::max(candidate.size(), word.size()) -
+                    std::min(candidate.size(), word.size());
+                if (difference > max_distance)
+                    continue;
+
+                int d = distance.to(candidate);
+                if (d == 0)
+                    return {};
+
+                if (d < best_distance)
+                {
+                    best = candidate;
+                    best_distance = d;
+                }
+            }
+
+            return best;
+        }
+
+        bool CorrectionIndex::build(const std::vector<std::string>& list,
+            const std::string& path)
+        {
+            /* Typed words are lowercase, so corrections are too */
+            auto words = normalize_words(list);
+
+            /* (hash, id) of every delete of every word */
+            std::vector<std::pair<uint32_t, uint32_t>> deletes;
+            std::vector<uint32_t> word_offsets = {0};
+            std::string text;
+            for (uint32_t id = 0; id < words.size(); id++)
+            {
+                auto& word = words[id];
+                text += word;
+                word_offsets.push_back(text.size());
+                if (word.empty() || (word.size() > EditDistance::MAX_LENGTH))
+                    continue;
+
+                for (auto& deleted : get_deletes(
+                    std::string_view(word).substr(0, PREFIX_LENGTH), MAX_DISTANCE))
+                {
+                    deletes.push_back({hash_bytes(deleted), id});
+                }
+            }
+
+            std::sort(deletes.begin(), deletes.end());
+            deletes.erase(std::unique(deletes.begin(), deletes.end()), deletes.end());
+
+            /* About one distinct hash per bucket */
+            size_t hashes = 0;
+            for (size_t i = 0; i < deletes.size(); i++)
+                hashes += (i == 0) || (deletes[i].first != deletes[i - 1].first);
+
+            uint32_t bucket_count = 1;
+            while (bucket_count < hashes)
+                bucket_count *= 2;
+
+            for (auto& [hash, id] : deletes)
+                hash &= bucket_count - 1;
+
+            std::sort(deletes.begin(), deletes.end());
+            deletes.erase(std::unique(deletes.begin(), deletes.end()), deletes.end());
+
+            std::vector<uint32_t> bucket_start(bucket_count + 1, 0), entries;
+            for (auto& [bucket, id] : deletes)
+            {
+                bucket_start[bucket + 1]++;
+                entries.push_back(id);
+            }
+
+            for (uint32_t i = 0; i < bucket_count; i++)
+                bucket_start[i + 1] += bucket_start[i];
+
+            correction_header_t header;
+            std::memcpy(header.magic, CORRECTION_MAGIC, sizeof(CORRECTION_MAGIC));
+            header.word_count = words.size();
+            header.text_size = text.size();
+            header.bucket_count = bucket_count;
+            header.entry_count = entries.size();
+            header.max_distance = MAX_DISTANCE;
+            header.prefix_length = PREFIX_LENGTH;
+
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            auto write = [&] (const std::vector<uint32_t>& section)
+            {
+                file.write((const char*)section.data(), section.size() * 4);
+            };
+
+            file.write((const char*)&header, sizeof(header));
+            write(word_offsets);
+            write(bucket_start);
+            write(entries);
+            file.write(text.data(), text.size());
+            return bool(file);
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wf
+{
+    namespace osk
+    {
+        /**
+         * Header of an autocorrection index file, followed by, in this
+         * order:
+         *
+         *   uint32_t word_offsets[word_count + 1]    into text
+         *   uint32_t bucket_start[bucket_count + 1]  into entries
+         *   uint32_t entries[entry_count]
+         *   char text[text_size]
+         *
+         * Word ids are ranks, 0 is the most frequent word. Every word is
+         * listed in the buckets of the strings obtained by deleting up to
+         * max_distance bytes from its first prefix_length bytes, a bucket
+         * being the hash of such a string modulo bucket_count, which is a
+         * power of two. Buckets are sorted by word id.
+         */
+        struct correction_header_t
+        {
+            char magic[8];
+            uint32_t word_count;
+            uint32_t text_size;
+            uint32_t bucket_count;
+            uint32_t entry_count;
+            uint32_t max_distance;
+            uint32_t prefix_length;
+        };
+
+        static constexpr char CORRECTION_MAGIC[8] = {'W', 'F', 'O', 'S', 'K', 'S', 'D', '1'};
+
+        /**
+         * Optimal string alignment distance (Levenshtein with transpositions
+         * of adjacent bytes) to a word of at most 64 bytes, computed a
+         * column at a time with one bit per byte of the word, following
+         * Hyyrö's bit-vector algorithm.
+         */
+        class EditDistance
+        {
+            uint64_t match[256] = {};
+            size_t length;
+
+            public:
+            static constexpr size_t MAX_LENGTH = 64;
+
+            EditDistance(std::string_view word);
+            int to(std::string_view other) const;
+        };
+
+        /**
+         * A symmetric delete index of a word list, used in place through
+         * mmap() like CompletionTrie. The candidates for a typed word are
+         * the words sharing one of its deletes, which are then ranked by
+         * their actual distance and their frequency.
+         */
+        class CorrectionIndex
+        {
+            const void *data = nullptr;
+            size_t size = 0;
+            const correction_header_t *header = nullptr;
+            const uint32_t *word_offsets, *bucket_start, *entries;
+            const char *text;
+
+            public:
+            /* Map the file, exits if it is not a valid index file */
+            CorrectionIndex(const std::string& path);
+            ~CorrectionIndex();
+            CorrectionIndex(const CorrectionIndex&) = delete;
+            CorrectionIndex& operator = (const CorrectionIndex&) = delete;
+
+            const correction_header_t& get_header() const;
+            std::string_view get_word(uint32_t id) const;
+
+            /**
+             * The closest word to a lowercase typed word, the most frequent
+             * one among equally close words. Empty if the word is in the
+             * index or no word is close enough.
+             */
+            std::string_view correct(std::string_view word) const;
+
+            /* Write an index file of the words, from most to least frequent,
+             * after normalize_words() */
+            static bool build(const std::vector<std::string>& words,
+                const std::string& path);
+        };
+    }
+}
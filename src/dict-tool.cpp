@@ -0,0 +1,85 @@
+#include "completion.hpp"
+#include "correction.hpp"
+#include "prediction.hpp"
+#include "word-list.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+static int usage(const char *name)
+{
+    std::cerr << "Usage: " << name << " trie <word list> <output>" << std::endl
+        << "       " << name << " ngram <text> <output>" << std::endl
+        << "       " << name << " correct <word list> <output>" << std::endl
+        << std::endl
+        << "The word list has one \"word\" or \"word count\" per line, "
+        << "without counts the most frequent words come first." << std::endl
+        << "The text can be any amount of plain text, from which the "
+        << "next-word model is learned." << std::endl;
+    return 1;
+}
+
+static int build_trie(const std::string& input, const std::string& output)
+{
+    std::vector<std::string> words;
+    for (auto& entry : wf::osk::read_word_list(input))
+        words.push_back(entry.word);
+
+    return wf::osk::CompletionTrie::build(words, output) ? 0 : -1;
+}
+
+static int build_correction(const std::string& input, const std::string& output)
+{
+    std::vector<std::string> words;
+    for (auto& entry : wf::osk::read_word_list(input))
+        words.push_back(entry.word);
+
+    if (!wf::osk::CorrectionIndex::build(words, output))
+        return -1;
+
+    wf::osk::CorrectionIndex index(output);
+    auto& header = index.get_header();
+    std::cout << "words: " << header.word_count
+        << ", buckets: " << header.bucket_count
+        << ", entries: " << header.entry_count << std::endl;
+    return 0;
+}
+
+static int build_ngram(const std::string& input, const std::string& output)
+{
+    std::ifstream corpus(input);
+    if (!corpus)
+    {
+        std::cerr << "Failed to open " << input << std::endl;
+        return 1;
+    }
+
+    if (!wf::osk::NgramModel::build(corpus, output))
+        return -1;
+
+    wf::osk::NgramModel model(output);
+    auto& header = model.get_header();
+    std::cout << "vocabulary: " << header.vocabulary_size
+        << ", bigrams: " << header.bigram_count
+        << ", trigram contexts: " << header.trigram_context_count
+        << ", trigrams: " << header.trigram_count << std::endl;
+    return 0;
+}
+
+/* Builds the binary dictionary files used by wf-osk */
+int main(int argc, char **argv)
+{
+    if (argc != 4)
+        return usage(argv[0]);
+
+    std::string command = argv[1];
+    int ret = (command == "trie") ? build_trie(argv[2], argv[3]) :
+        (command == "ngram") ? build_ngram(argv[2], argv[3]) :
+        (command == "correct") ? build_correction(argv[2], argv[3]) : usage(argv[0]);
+
+    if (ret < 0)
+        std::cerr << "Failed to write " << argv[3] << std::endl;
+
+    return ret ? 1 : 0;
+}
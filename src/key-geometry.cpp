@@ -0,0 +1,146 @@
+#include "key-geometry.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wf
+{
+    namespace osk
+    {
+        void KeyGeometry::update(const std::vector<double>& key_widths,
+            const std::vector<size_t>& row_sizes,
+            int width, int height, int spacing)
+        {
+            size_t count = key_widths.size();
+            x.resize(count);
+            y.resize(count);
+            this->width.resize(count);
+            this->height.resize(count);
+
+            int rows = row_sizes.size();
+            double row_height = rows ?
+                double(height - (rows - 1) * spacing) / rows : 0;
+
+            size_t first = 0;
+            for (int i = 0; i < rows; i++)
+            {
+                size_t row_size = row_sizes[i];
+                double sum = 0;
+                for (size_t j = first; j < first + row_size; j++)
+                    sum += key_widths[j];
+
+                double total_keys = width -
+                    std::max(int(row_size) - 1, 0) * spacing;
+
+                /* Keys are aligned to whole pixels, so that their sprites
+                 * can be blitted without resampling */
+                double key_x = 0;
+                double key_y = std::round(i * (row_height + spacing));
+                for (size_t j = first; j < first + row_size; j++)
+                {
+                    double key_width = key_widths[j] / sum * total_keys;
+                    x[j] = std::round(key_x);
+                    y[j] = key_y;
+                    this->width[j] = std::round(key_x + key_width) - x[j];
+                    this->height[j] = std::round(row_height);
+                    key_x += key_width + spacing;
+                }
+
+                first += row_size;
+            }
+
+            build_grid(width, height);
+        }
+
+        void KeyGeometry::build_grid(int width, int height)
+        {
+            size_t count = size();
+            cell_width = cell_height = 1;
+            if (count)
+            {
+                cell_width = std::max(1.0,
+                    *std::min_element(this->width.begin(), this->width.end()));
+                cell_height = std::max(1.0,
+                    *std::min_element(this->height.begin(), this->height.end()));
+            }
+
+            grid_columns = std::max(1, int(std::ceil(width / cell_width)));
+            grid_rows = std::max(1, int(std::ceil(height / cell_height)));
+
+            /* Cells covered by a key, clamped to the grid */
+            auto cell_range = [=] (double start, double size, double cell, int max,
+                int& first, int& last)
+            {
+                first = std::clamp(int(start / cell), 0, max - 1);
+                last = std::clamp(int(std::ceil((start + size) / cell)) - 1,
+                    first, max - 1);
+            };
+
+            /* Count the keys of every cell, then fill them in */
+            cell_start.assign(grid_columns * grid_rows + 1, 0);
+            for (int pass = 0; pass < 2; pass++)
+            {
+                std::vector<uint32_t> fill;
+                if (pass == 1)
+                {
+                    for (size_t i = 1; i < cell_start.size(); i++)
+                        cell_start[i] += cell_start[i - 1];
+
+                    cell_keys.resize(cell_start.back());
+                    fill.assign(cell_start.begin(), cell_start.end() - 1);
+                }
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    int col1, col2, row1, row2;
+                    cell_range(x[i], this->width[i], cell_width, grid_columns,
+                        col1, col2);
+                    cell_range(y[i], this->height[i], cell_height, grid_rows,
+                        row1, row2);
+
+                    for (int row = row1; row <= row2; row++)
+                    {
+                        for (int col = col1; col <= col2; col++)
+                        {
+                            int cell = row * grid_columns + col;
+                            if (pass == 0)
+                                cell_start[cell + 1]++;
+                            else
+                                cell_keys[fill[cell]++] = i;
+                        }
+                    }
+                }
+            }
+        }
+
+        size_t KeyGeometry::size() const
+        {
+            return x.size();
+        }
+
+        int KeyGeometry::key_at(double px, double py) const
+        {
+            if ((px < 0) || (py < 0) || cell_start.empty())
+                return -1;
+
+            int col = px / cell_width, row = py / cell_height;
+            if ((col >= grid_columns) || (row >= grid_rows))
+                return -1;
+
+            /* A cell is no larger than any key, so it overlaps at most
+             * two keys in each direction */
+            int cell = row * grid_columns + col;
+            for (uint32_t k = cell_start[cell]; k < cell_start[cell + 1]; k++)
+            {
+                int i = cell_keys[k];
+                if ((px >= x[i]) && (px < x[i] + width[i]) &&
+                    (py >= y[i]) && (py < y[i] + height[i]))
+                {
+                    return i;
+                }
+            }
+
+            return -1;
+        }
+    }
+}
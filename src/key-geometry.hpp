@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace wf
+{
+    namespace osk
+    {
+        /**
+         * Positions of the keys of a layout in widget coordinates, as a
+         * structure of arrays indexed by key, in row order.
+         *
+         * A uniform grid with cells no larger than the smallest key maps
+         * a point to the few keys which can contain it, so key_at() takes
+         * constant time regardless of the number of keys.
+         */
+        class KeyGeometry
+        {
+            int grid_columns = 0, grid_rows = 0;
+            double cell_width = 1, cell_height = 1;
+            /* The keys overlapping cell i are
+             * cell_keys[cell_start[i]] .. cell_keys[cell_start[i + 1] - 1] */
+            std::vector<uint32_t> cell_start;
+            std::vector<uint16_t> cell_keys;
+
+            void build_grid(int width, int height);
+
+            public:
+            std::vector<double> x, y, width, height;
+
+            /**
+             * Lay out rows of keys in a width x height area, with the same
+             * math as KeyboardLayout and KeyboardRow: the keys of a row
+             * share the width left after spacing in proportion to their
+             * relative widths. Keys are aligned to whole pixels, so they
+             * can be a pixel larger than the truncated button sizes.
+             */
+            void update(const std::vector<double>& key_widths,
+                const std::vector<size_t>& row_sizes,
+                int width, int height, int spacing);
+
+            size_t size() const;
+            /* Index of the key containing the point, or -1 */
+            int key_at(double px, double py) const;
+        };
+    }
+}
@@ -0,0 +1,480 @@
+#include "osk.hpp"
+#include "latency.hpp"
+
+#include <cmath>
+#include <cctype>
+
+namespace wf
+{
+    namespace osk
+    {
+        static constexpr int SWIPE_TRAIL_WIDTH = 6;
+        /* How far from the press point, in key widths, a press has to move
+         * to turn into a swipe, so that a tap jittering across the edge of
+         * its key still types the key */
+        static constexpr double SWIPE_START_DISTANCE = 0.5;
+
+        KeyboardCanvas::KeyboardCanvas(const LayoutTable& keys,
+            int32_t width, int32_t height)
+        {
+            latency::scope_t timer(latency::STAGE_LAYOUT_BUILD);
+            set_size_request(width, height);
+            add_events(Gdk::BUTTON_PRESS_MASK | Gdk::BUTTON_RELEASE_MASK |
+                Gdk::BUTTON1_MOTION_MASK | Gdk::TOUCH_MASK);
+            set_keys(keys);
+        }
+
+        void KeyboardCanvas::set_keys(const LayoutTable& keys)
+        {
+            this->keys.clear();
+            this->row_sizes.clear();
+            for (auto& row : keys)
+            {
+                this->keys.insert(this->keys.end(), row.begin(), row.end());
+                this->row_sizes.push_back(row.size());
+            }
+
+            /* Held keys are still released with the code they were pressed
+             * with, but are not drawn as pressed in the new layout */
+            this->pressed_count.assign(this->keys.size(), 0);
+            for (auto& press : presses)
+                press.second.key = -1;
+
+            /* A swipe is over, its trail has no meaning on the new keys */
+            swipe_tracking = swiping = false;
+
+            update_geometry();
+            queue_draw();
+        }
+
+        void KeyboardCanvas::update_geometry()
+        {
+            int width = get_allocated_width();
+            int height = get_allocated_height();
+            if (width <= 1 || height <= 1)
+                get_size_request(width, height);
+
+            std::vector<double> key_widths;
+            for (auto& key : keys)
+                key_widths.push_back(key.width);
+
+            stats.surface_pixels = uint64_t(width) * height;
+            geometry.update(key_widths, row_sizes, width, height, spacing);
+        }
+
+        void KeyboardCanvas::queue_draw_key(int i)
+        {
+            if ((i < 0) || (i >= (int)geometry.size()))
+                return;
+
+            /* Keys are drawn inside their rectangle, outline included */
+            stats.damaged_pixels += uint64_t(geometry.width[i] * geometry.height[i]);
+            queue_draw_area(geometry.x[i], geometry.y[i],
+                geometry.width[i], geometry.height[i]);
+        }
+
+        const render_stats_t& KeyboardCanvas::get_stats() const
+        {
+            return stats;
+        }
+
+        void KeyboardCanvas::on_size_allocate(Gtk::Allocation& allocation)
+        {
+            Gtk::DrawingArea::on_size_allocate(allocation);
+            /* Sprites of the old key sizes would never be used again */
+            if (uint64_t(allocation.get_width()) * allocation.get_height() !=
+                stats.surface_pixels)
+            {
+                clear_sprites();
+            }
+
+            update_geometry();
+        }
+
+        KeyboardCanvas::key_look_t KeyboardCanvas::get_key_look(size_t i) const
+        {
+            uint32_t modifier = IS_MODIFIER(keys[i].code) ?
+                (keys[i].code & ~MODIFIER_KEY) : 0;
+            if (locked_modifiers & modifier)
+                return KEY_LOCKED;
+
+            if ((pressed_count[i] > 0) || (latched_modifiers & modifier))
+                return KEY_PRESSED;
+
+            return KEY_NORMAL;
+        }
+
+        void KeyboardCanvas::show_modifiers(uint32_t latched, uint32_t locked)
+        {
+            /* Only the keys of the modifiers which changed */
+            uint32_t changed = (latched ^ latched_modifiers) | (locked ^ locked_modifiers);
+            latched_modifiers = latched;
+            locked_modifiers = locked;
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                if (IS_MODIFIER(keys[i].code) && (keys[i].code & ~MODIFIER_KEY & changed))
+                    queue_draw_key(i);
+            }
+        }
+
+        void KeyboardCanvas::render_key(const Cairo::RefPtr<Cairo::Context>& cr,
+            size_t i, key_look_t look)
+        {
+            /* The outline is stroked on the pixels along the edges */
+            const double x = 0.5, y = 0.5;
+            const double width = geometry.width[i] - 1;
+            const double height = geometry.height[i] - 1;
+            const double radius = std::min(4.0, std::min(width, height) / 2);
+            auto& color = sprite_color;
+
+            cr->begin_new_sub_path();
+            cr->arc(x + width - radius, y + radius, radius, -M_PI / 2, 0);
+            cr->arc(x + width - radius, y + height - radius, radius, 0, M_PI / 2);
+            cr->arc(x + radius, y + height - radius, radius, M_PI / 2, M_PI);
+            cr->arc(x + radius, y + radius, radius, M_PI, 3 * M_PI / 2);
+            cr->close_path();
+
+            cr->set_source_rgba(color.get_red(), color.get_green(),
+                color.get_blue(), (look == KEY_NORMAL) ? 0.08 : 0.3);
+            cr->fill_preserve();
+            cr->set_source_rgba(color.get_red(), color.get_green(),
+                color.get_blue(), 0.2);
+            cr->set_line_width(1);
+            cr->stroke();
+
+            if (keys[i].text.empty())
+                return;
+
+            auto label = create_pango_layout(std::string(keys[i].text));
+            int label_width, label_height;
+            label->get_pixel_size(label_width, label_height);
+
+            cr->set_source_rgba(color.get_red(), color.get_green(),
+                color.get_blue(), color.get_alpha());
+            cr->move_to(x + (width - label_width) / 2,
+                y + (height - label_height) / 2);
+            label->show_in_cairo_context(cr);
+
+            if (look == KEY_LOCKED)
+            {
+                cr->rectangle(x + (width - label_width) / 2,
+                    y + (height + label_height) / 2, label_width, 2);
+                cr->fill();
+            }
+        }
+
+        Cairo::RefPtr<Cairo::ImageSurface> KeyboardCanvas::get_sprite(size_t i,
+            key_look_t look)
+        {
+            sprite_key_t key{keys[i].text,
+                int(geometry.width[i]), int(geometry.height[i]), look};
+
+            auto it = sprites.find(key);
+            if (it != sprites.end())
+            {
+                stats.sprite_hits++;
+                return it->second;
+            }
+
+            stats.sprite_misses++;
+            int scale = sprite_scale;
+            auto sprite = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32,
+                std::get<1>(key) * scale, std::get<2>(key) * scale);
+            cairo_surface_set_device_scale(sprite->cobj(), scale, scale);
+            render_key(Cairo::Context::create(sprite), i, look);
+
+            stats.sprite_bytes += sprite->get_stride() * sprite->get_height();
+            sprites.emplace(key, sprite);
+            return sprite;
+        }
+
+        void KeyboardCanvas::clear_sprites()
+        {
+            sprites.clear();
+            stats.sprite_bytes = 0;
+        }
+
+        void KeyboardCanvas::on_style_updated()
+        {
+            Gtk::DrawingArea::on_style_updated();
+            /* The font or colors of the theme may have changed */
+            clear_sprites();
+            queue_draw();
+        }
+
+        bool KeyboardCanvas::on_draw(const Cairo::RefPtr<Cairo::Context>& cr)
+        {
+            latency::scope_t timer(latency::STAGE_DRAW);
+            std::vector<Cairo::Rectangle> damage;
+            cr->copy_clip_rectangle_list(damage);
+
+            stats.draws++;
+            for (auto& rect : damage)
+                stats.repainted_pixels += uint64_t(rect.width * rect.height);
+
+            auto color = get_style_context()->get_color(get_state_flags());
+            if ((color != sprite_color) || (get_scale_factor() != sprite_scale))
+            {
+                clear_sprites();
+                sprite_color = color;
+                sprite_scale = get_scale_factor();
+            }
+
+            /* Skip the keys outside of the damaged area, cairo would clip
+             * them anyway but only after looking up their sprites */
+            auto& g = geometry;
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                for (auto& rect : damage)
+                {
+                    if ((g.x[i] < rect.x + rect.width) &&
+                        (rect.x < g.x[i] + g.width[i]) &&
+                        (g.y[i] < rect.y + rect.height) &&
+                        (rect.y < g.y[i] + g.height[i]))
+                    {
+                        cr->set_source(get_sprite(i, get_key_look(i)),
+                            g.x[i], g.y[i]);
+                        cr->paint();
+                        break;
+                    }
+                }
+            }
+
+            if (swiping && (trail.size() > 1))
+            {
+                cr->set_source_rgba(sprite_color.get_red(), sprite_color.get_green(),
+                    sprite_color.get_blue(), 0.5);
+                cr->set_line_width(SWIPE_TRAIL_WIDTH);
+                cr->set_line_cap(Cairo::LINE_CAP_ROUND);
+                cr->set_line_join(Cairo::LINE_JOIN_ROUND);
+                cr->move_to(trail[0].x, trail[0].y);
+                for (auto& point : trail)
+                    cr->line_to(point.x, point.y);
+
+                cr->stroke();
+            }
+
+            return true;
+        }
+
+        void KeyboardCanvas::set_swipe_enabled(bool enabled)
+        {
+            this->swipe_enabled = enabled;
+        }
+
+        /* The letter typed by a key, 0 for other keys */
+        static char key_letter(const Key& key)
+        {
+            if ((key.text.size() != 1) || !std::isalpha((unsigned char)key.text[0]))
+                return 0;
+
+            return std::tolower((unsigned char)key.text[0]);
+        }
+
+        swipe_request_t KeyboardCanvas::make_swipe_request() const
+        {
+            swipe_request_t request;
+            request.path = trail;
+            request.first = key_letter(keys[swipe_key]);
+            request.centers.fill({-1, -1});
+
+            double total_width = 0;
+            int letters = 0;
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                if (char letter = key_letter(keys[i]))
+                {
+                    request.centers[letter - 'a'] = {
+                        geometry.x[i] + geometry.width[i] / 2,
+                        geometry.y[i] + geometry.height[i] / 2};
+                    total_width += geometry.width[i];
+                    letters++;
+                }
+            }
+
+            request.key_width = letters ? total_width / letters : 1;
+            return request;
+        }
+
+        void KeyboardCanvas::queue_draw_trail(double x1, double y1,
+            double x2, double y2)
+        {
+            const int pad = SWIPE_TRAIL_WIDTH / 2 + 1;
+            queue_draw_area(std::floor(std::min(x1, x2)) - pad,
+                std::floor(std::min(y1, y2)) - pad,
+                std::ceil(std::abs(x2 - x1)) + 2 * pad + 1,
+                std::ceil(std::abs(y2 - y1)) + 2 * pad + 1);
+        }
+
+        void KeyboardCanvas::begin_press(GdkEventSequence *sequence,
+            double x, double y)
+        {
+            if (presses.count(sequence))
+                return;
+
+            int key;
+            {
+                latency::scope_t timer(latency::STAGE_HIT_TEST);
+                key = geometry.key_at(x, y);
+            }
+
+            if (key < 0)
+                return;
+
+            uint32_t code = keys[key].code;
+            presses[sequence] = {key, code};
+            pressed_count[key]++;
+            stats.key_events++;
+            stats.max_presses = std::max<uint64_t>(stats.max_presses,
+                presses.size());
+            queue_draw_key(key);
+
+            /* A second finger lands before the first one swiped */
+            if (swipe_tracking && !swiping)
+                swipe_tracking = false;
+
+            if (swipe_enabled && !swiping && (presses.size() == 1) &&
+                key_letter(keys[key]))
+            {
+                swipe_tracking = true;
+                swipe_sequence = sequence;
+                swipe_key = key;
+                trail = {{x, y}};
+                trail_x1 = trail_x2 = x;
+                trail_y1 = trail_y2 = y;
+            }
+
+            latency::keystroke_t keystroke;
+            auto& keyboard = Keyboard::get();
+            keystroke.mark(latency::STAGE_KEYBOARD_GET);
+            keyboard.press_key(code, keystroke);
+        }
+
+        void KeyboardCanvas::update_press(GdkEventSequence *sequence,
+            double x, double y)
+        {
+            if (!swipe_tracking || (sequence != swipe_sequence))
+                return;
+
+            auto& last = trail.back();
+            queue_draw_trail(last.x, last.y, x, y);
+            trail.push_back({x, y});
+            trail_x1 = std::min(trail_x1, x);
+            trail_y1 = std::min(trail_y1, y);
+            trail_x2 = std::max(trail_x2, x);
+            trail_y2 = std::max(trail_y2, y);
+
+            /* Sliding within the key is not a swipe yet */
+            if (swiping || (geometry.key_at(x, y) == swipe_key))
+                return;
+
+            auto press = presses.find(sequence);
+            if ((press == presses.end()) || (press->second.key != swipe_key))
+            {
+                swipe_tracking = false;
+                return;
+            }
+
+            double dx = x - trail.front().x, dy = y - trail.front().y;
+            double min_distance = SWIPE_START_DISTANCE * geometry.width[swipe_key];
+            if (dx * dx + dy * dy < min_distance * min_distance)
+                return;
+
+            /* The key typed its letter, which starts the word */
+            swiping = true;
+            press->second.swiped = true;
+            queue_draw_trail(trail_x1, trail_y1, trail_x2, trail_y2);
+            Keyboard::get().release_key(press->second.code);
+        }
+
+        void KeyboardCanvas::end_press(GdkEventSequence *sequence)
+        {
+            auto it = presses.find(sequence);
+            if (it == presses.end())
+                return;
+
+            auto press = it->second;
+            presses.erase(it);
+            if (press.key >= 0)
+            {
+                pressed_count[press.key]--;
+                queue_draw_key(press.key);
+            }
+
+            if (swipe_tracking && (sequence == swipe_sequence))
+            {
+                swipe_tracking = swiping = false;
+                queue_draw_trail(trail_x1, trail_y1, trail_x2, trail_y2);
+            }
+
+            /* The key of a swipe was released when it started */
+            if (press.swiped)
+            {
+                if (press.key >= 0)
+                    Keyboard::get().decode_swipe(make_swipe_request());
+
+                return;
+            }
+
+            stats.key_events++;
+            /* May switch layouts, so nothing of the canvas is used after */
+            Keyboard::get().release_key(press.code);
+        }
+
+        bool KeyboardCanvas::on_button_press_event(GdkEventButton *event)
+        {
+            /* Touches are handled as touch events */
+            if ((event->button == 1) &&
+                !gdk_event_get_pointer_emulated((GdkEvent*)event))
+            {
+                begin_press(nullptr, event->x, event->y);
+            }
+
+            return true;
+        }
+
+        bool KeyboardCanvas::on_button_release_event(GdkEventButton *event)
+        {
+            if ((event->button == 1) &&
+                !gdk_event_get_pointer_emulated((GdkEvent*)event))
+            {
+                end_press(nullptr);
+            }
+
+            return true;
+        }
+
+        bool KeyboardCanvas::on_motion_notify_event(GdkEventMotion *event)
+        {
+            if (!gdk_event_get_pointer_emulated((GdkEvent*)event))
+                update_press(nullptr, event->x, event->y);
+
+            return true;
+        }
+
+        bool KeyboardCanvas::on_touch_event(GdkEventTouch *event)
+        {
+            switch (event->type)
+            {
+              case GDK_TOUCH_BEGIN:
+                begin_press(event->sequence, event->x, event->y);
+                break;
+
+              case GDK_TOUCH_UPDATE:
+                update_press(event->sequence, event->x, event->y);
+                break;
+
+              /* A cancelled touch still has to release its key */
+              case GDK_TOUCH_END:
+              case GDK_TOUCH_CANCEL:
+                end_press(event->sequence);
+                break;
+
+              default:
+                break;
+            }
+
+            return true;
+        }
+    }
+}
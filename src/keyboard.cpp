@@ -0,0 +1,702 @@
+#include "osk.hpp"
+#include "keymap.hpp"
+#include "latency.hpp"
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <linux/input-event-codes.h>
+
+namespace wf
+{
+    namespace osk
+    {
+        std::u32string utf8_to_utf32(const std::string& text)
+        {
+            std::u32string result;
+            for (gunichar ch : Glib::ustring(text))
+                result += ch;
+
+            return result;
+        }
+
+        int spacing = OSK_SPACING;
+        int default_width = 800;
+        int default_height = 400;
+        int headerbar_size = 60;
+        int repeat_delay = 400;
+        int repeat_rate = 25;
+        double repeat_acceleration = 0.9;
+        bool use_canvas = false;
+        std::string dictionary_path;
+        std::string completion_path;
+        std::string prediction_path;
+        std::string correction_path;
+        std::string layout_path;
+        bool learn_words = false;
+
+        std::string anchor;
+
+        static constexpr char uppercase_letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+        /* Shifted labels are only computed for ASCII letters, no other
+         * label in the layouts changes with shift */
+        static constexpr std::string_view shifted_label(std::string_view label)
+        {
+            if ((label.size() == 1) && (label[0] >= 'a') && (label[0] <= 'z'))
+                return std::string_view(uppercase_letters + (label[0] - 'a'), 1);
+
+            if (label == "ABC")
+                return "abc";
+
+            return label;
+        }
+
+        template<size_t N>
+        static constexpr std::array<Key, N> shifted_row(const Key (&row)[N])
+        {
+            std::array<Key, N> shifted = {};
+            for (size_t i = 0; i < N; i++)
+            {
+                shifted[i] = row[i];
+                if (IS_MODIFIER(row[i].code))
+                    continue;
+
+                shifted[i].text = shifted_label(row[i].text);
+                if (row[i].code < USE_SHIFT)
+                    shifted[i].code |= USE_SHIFT;
+            }
+
+            return shifted;
+        }
+
+        template<size_t N>
+        static constexpr KeyRowTable make_row(const Key (&row)[N])
+        {
+            return {row, N};
+        }
+
+        template<size_t N>
+        static constexpr KeyRowTable make_row(const std::array<Key, N>& row)
+        {
+            return {row.data(), N};
+        }
+
+        template<size_t N>
+        static constexpr LayoutTable make_layout(const KeyRowTable (&rows)[N])
+        {
+            return {rows, N};
+        }
+
+        /* Defines default_keys, shift_keys and numeric_keys */
+        #include "layouts.tpp"
+
+        const LayoutTable& get_builtin_layout(layout_id_t id)
+        {
+            static const LayoutTable *tables[LAYOUT_COUNT] = {
+                &default_keys, &shift_keys, &numeric_keys,
+            };
+
+            return *tables[id];
+        }
+
+        KeyButton::KeyButton(Key key, int width, int height)
+        {
+            this->code = key.code;
+
+            this->button.set_size_request(width, height);
+            this->button.set_label(std::string(key.text));
+
+            this->button.signal_pressed().connect_notify(
+                sigc::mem_fun(this, &KeyButton::on_pressed));
+            this->button.signal_released().connect_notify(
+                sigc::mem_fun(this, &KeyButton::on_released));
+        }
+
+        void KeyButton::set_key(const Key& key)
+        {
+            this->code = key.code;
+            this->button.set_label(std::string(key.text));
+        }
+
+        void KeyButton::show_modifiers(uint32_t latched, uint32_t locked)
+        {
+            uint32_t modifier = IS_MODIFIER(code) ? (code & ~MODIFIER_KEY) : 0;
+            auto style = button.get_style_context();
+            auto set_class = [&] (const char *name, bool set)
+            {
+                if (set)
+                    style->add_class(name);
+                else
+                    style->remove_class(name);
+            };
+
+            set_class("latched", latched & modifier);
+            set_class("locked", locked & modifier);
+
+            /* Unlike the active state, the button keeps this one when it
+             * is released */
+            if ((latched | locked) & modifier)
+                button.set_state_flags(Gtk::STATE_FLAG_CHECKED, false);
+            else
+                button.unset_state_flags(Gtk::STATE_FLAG_CHECKED);
+        }
+
+        void KeyButton::on_pressed()
+        {
+            this->pressed_code = this->code;
+            latency::keystroke_t keystroke;
+            auto& keyboard = Keyboard::get();
+            keystroke.mark(latency::STAGE_KEYBOARD_GET);
+            keyboard.press_key(this->pressed_code, keystroke);
+        }
+
+        void KeyButton::on_released()
+        {
+            /* The key may have been relabeled while it was held */
+            Keyboard::get().release_key(this->pressed_code);
+        }
+
+        KeyboardRow::KeyboardRow(const KeyRowTable& keys,
+            int width, int height)
+        {
+            double sum = 0;
+            for (auto& key : keys)
+                sum += key.width;
+
+            box.set_spacing(spacing);
+            int total_spacing = std::max((int)keys.size() - 1, 0) * spacing;
+            int total_buttons = width - total_spacing;
+
+            for (auto& key : keys)
+            {
+                this->keys.emplace_back(std::make_unique<KeyButton>
+                    (key, int(key.width / sum * total_buttons), height));
+                this->box.pack_start(this->keys.back()->button);
+            }
+        }
+
+        KeyboardLayout::KeyboardLayout(const LayoutTable& keys,
+            int32_t width, int32_t height)
+        {
+            latency::scope_t timer(latency::STAGE_LAYOUT_BUILD);
+            box.set_spacing(spacing);
+            int total_spacing = std::max((int)keys.size() - 1, 0) * spacing;
+
+            int row_height = (height - total_spacing) / keys.size();
+            for (auto& row : keys)
+            {
+                this->rows.emplace_back(
+                    std::make_unique<KeyboardRow> (row, width, row_height));
+                this->box.pack_start(this->rows.back()->box);
+            }
+        }
+
+        void KeyboardLayout::set_keys(const LayoutTable& keys)
+        {
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                auto& row = keys.rows[i];
+                for (size_t j = 0; j < rows[i]->keys.size(); j++)
+                    rows[i]->keys[j]->set_key(row.keys[j]);
+            }
+        }
+
+        void KeyboardLayout::show_modifiers(uint32_t latched, uint32_t locked)
+        {
+            for (auto& row : rows)
+            {
+                for (auto& key : row->keys)
+                    key->show_modifiers(latched, locked);
+            }
+        }
+
+        SuggestionBar::SuggestionBar(int height)
+        {
+            box.set_spacing(spacing);
+            box.set_homogeneous(true);
+            for (int i = 0; i < SUGGESTIONS; i++)
+            {
+                buttons[i].set_size_request(-1, height);
+                buttons[i].signal_clicked().connect_notify([=] ()
+                {
+                    if (i < (int)words.size())
+                        Keyboard::get().accept_suggestion(words[i]);
+                });
+
+                box.pack_start(buttons[i]);
+            }
+        }
+
+        void SuggestionBar::set_words(std::vector<std::string> words)
+        {
+            this->words = std::move(words);
+            for (int i = 0; i < SUGGESTIONS; i++)
+            {
+                /* Unchanged labels do not need a new size allocation */
+                std::string label = (i < (int)this->words.size()) ?
+                    this->words[i] : "";
+                if (buttons[i].get_label() != label)
+                    buttons[i].set_label(label);
+            }
+        }
+
+        void Keyboard::init_layouts()
+        {
+            latency::scope_t timer(latency::STAGE_INIT_LAYOUTS);
+
+            if (!layout_path.empty())
+            {
+                layout_file = std::make_unique<LayoutFile>(layout_path);
+                for (int i = 0; i < LAYOUT_COUNT; i++)
+                    layouts[i] = layout_file->get(layout_id_t(i));
+            } else
+            {
+                for (int i = 0; i < LAYOUT_COUNT; i++)
+                    layouts[i] = get_builtin_layout(layout_id_t(i));
+            }
+
+            /* Only the default layout is needed for the first frame, the
+             * numeric layout, which many sessions never open, is built on
+             * first use */
+            this->current_keys = &layouts[LAYOUT_DEFAULT];
+            if (use_canvas)
+            {
+                this->canvas = std::make_unique<KeyboardCanvas>
+                    (layouts[LAYOUT_DEFAULT], default_width, default_height);
+            } else
+            {
+                this->default_layout = std::make_unique<KeyboardLayout>
+                    (layouts[LAYOUT_DEFAULT], default_width, default_height);
+            }
+
+            for (auto& layout : layouts)
+            {
+                for (auto& row : layout)
+                {
+                    for (auto& key : row)
+                    {
+                        if (!IS_COMMAND(key.code) && !IS_MODIFIER(key.code))
+                            this->used_keycodes.insert(key.code & ~USE_SHIFT);
+                    }
+                }
+            }
+        }
+
+        repeat_config_t get_repeat_config()
+        {
+            repeat_config_t repeat;
+            repeat.delay_ms = repeat_delay;
+            repeat.rate = repeat_rate;
+            /* Editing and navigation keys speed up the longer they are held */
+            for (uint32_t key : {KEY_BACKSPACE, KEY_DELETE,
+                    KEY_LEFT, KEY_RIGHT, KEY_UP, KEY_DOWN})
+            {
+                repeat.acceleration[key] = repeat_acceleration;
+            }
+
+            return repeat;
+        }
+
+        KeyboardLayout *Keyboard::get_layout(std::unique_ptr<KeyboardLayout>& layout,
+            const LayoutTable& keys)
+        {
+            if (!layout)
+            {
+                layout = std::make_unique<KeyboardLayout>
+                    (keys, default_width, default_height);
+            }
+
+            return layout.get();
+        }
+
+        void Keyboard::set_layout(KeyboardLayout *new_layout)
+        {
+            this->current_layout = new_layout;
+            window->set_widget(new_layout->box);
+            show_modifiers();
+        }
+
+        void Keyboard::show_modifiers()
+        {
+            if (!vk)
+                return;
+
+            uint32_t latched = vk->get_latched_modifiers();
+            uint32_t locked = vk->get_locked_modifiers();
+            if (canvas)
+                canvas->show_modifiers(latched, locked);
+            else if (current_layout)
+                current_layout->show_modifiers(latched, locked);
+        }
+
+        Keyboard::Keyboard()
+        {
+            window = std::make_unique<WaylandWindow>
+                (default_width, default_height, anchor, headerbar_size);
+            init_layouts();
+
+            /* Text with characters the layouts lack goes through the
+             * slots of the device, the keymap stays minimal */
+            vk = std::make_unique<VirtualKeyboardDevice>
+                (used_keycodes, get_repeat_config());
+            vk->set_modifiers_changed([=] () { show_modifiers(); });
+
+            text_server = std::make_unique<TextServer>([=] (const std::string& text)
+            {
+                size_t missing = vk->type_text(utf8_to_utf32(text));
+                /* The text is not part of the word being typed */
+                end_word(false);
+                return missing;
+            });
+
+            if (canvas && !dictionary_path.empty())
+            {
+                swipe_decoder = std::make_unique<SwipeDecoder>(dictionary_path,
+                    [=] (std::string word) { on_swipe_decoded(word); });
+                canvas->set_swipe_enabled(true);
+            }
+
+            if (!completion_path.empty())
+                completion = std::make_unique<CompletionTrie>(completion_path);
+
+            if (!prediction_path.empty())
+                prediction = std::make_unique<NgramModel>(prediction_path);
+
+            if (!correction_path.empty())
+                correction = std::make_unique<CorrectionIndex>(correction_path);
+
+            if (learn_words)
+            {
+                user_dictionary = std::make_unique<UserDictionary>(
+                    UserDictionary::default_directory(),
+                    [=] () { load_learned_words(); });
+                load_learned_words();
+            }
+
+            if (completion || prediction || user_dictionary)
+            {
+                suggestion_bar = std::make_unique<SuggestionBar>(headerbar_size * 2 / 3);
+                window->add_top_widget(suggestion_bar->box);
+            }
+
+            end_word(false);
+
+            if (canvas)
+                window->set_widget(*canvas);
+            else
+                set_layout(default_layout.get());
+        }
+
+        std::unique_ptr<Keyboard> Keyboard::instance;
+        void Keyboard::create()
+        {
+            if (instance)
+                throw std::logic_error("Creating keyboard twice!");
+
+            instance = std::unique_ptr<Keyboard>(new Keyboard());
+        }
+
+        Keyboard& Keyboard::get()
+        {
+            if (!instance)
+                throw std::logic_error("Getting keyboard before creating it!");
+
+            return *instance;
+        }
+
+        void Keyboard::destroy()
+        {
+            instance.reset();
+        }
+
+        VirtualKeyboardDevice& Keyboard::get_device()
+        {
+            return *vk;
+        }
+
+        Gtk::Window& Keyboard::get_window()
+        {
+            return *window;
+        }
+
+        UserDictionary *Keyboard::get_user_dictionary() const
+        {
+            return user_dictionary.get();
+        }
+
+        const KeyboardCanvas *Keyboard::get_canvas() const
+        {
+            return canvas.get();
+        }
+
+        void Keyboard::show_keys(const LayoutTable& keys)
+        {
+            this->current_keys = &keys;
+            if (canvas)
+            {
+                canvas->set_keys(keys);
+            } else if (&keys == &layouts[LAYOUT_NUMERIC])
+            {
+                set_layout(get_layout(numeric_layout, keys));
+            } else
+            {
+                default_layout->set_keys(keys);
+                if (current_layout != default_layout.get())
+                    set_layout(default_layout.get());
+            }
+
+            /* Relabeled keys may have become modifier keys, or stopped
+             * being ones */
+            show_modifiers();
+        }
+
+        void Keyboard::handle_action(uint32_t action)
+        {
+            latency::scope_t timer(latency::STAGE_LAYOUT_SWITCH);
+            /* Toggle shift, or go back to the unshifted letters */
+            if (action == ABC_TOGGLE)
+            {
+                show_keys((current_keys == &layouts[LAYOUT_DEFAULT]) ?
+                    layouts[LAYOUT_SHIFT] : layouts[LAYOUT_DEFAULT]);
+            }
+
+            if (action == NUM_TOGGLE)
+                show_keys(layouts[LAYOUT_NUMERIC]);
+        }
+
+        void Keyboard::press_key(uint32_t code, latency::keystroke_t& keystroke)
+        {
+            if (IS_COMMAND(code) || IS_MODIFIER(code))
+                return;
+
+            /* The correction is typed before the key which ends the word */
+            autocorrect(code);
+            keystroke.mark(latency::STAGE_AUTOCORRECT);
+
+            if (code & USE_SHIFT)
+                vk->hold_modifier(MODIFIER_SHIFT, true);
+
+            /* Another finger already holds the key, lift it so that this
+             * press types again */
+            if (held_keys[code & ~USE_SHIFT]++ > 0)
+                vk->send_key(code & ~(USE_SHIFT), WL_KEYBOARD_KEY_STATE_RELEASED);
+
+            vk->send_key(code & ~(USE_SHIFT), WL_KEYBOARD_KEY_STATE_PRESSED);
+            keystroke.mark(latency::STAGE_SEND_KEY);
+
+            vk->flush();
+            keystroke.mark(latency::STAGE_FLUSH);
+            keystroke.finish();
+
+            update_word(code);
+            keystroke.mark(latency::STAGE_SUGGEST);
+        }
+
+        void Keyboard::release_key(uint32_t code)
+        {
+            if (IS_COMMAND(code))
+                return handle_action(code);
+
+            if (IS_MODIFIER(code))
+            {
+                vk->tap_modifier(code & ~MODIFIER_KEY);
+                vk->flush();
+                return;
+            }
+
+            if (code & USE_SHIFT)
+                vk->hold_modifier(MODIFIER_SHIFT, false);
+
+            /* The key is released with the last press holding it */
+            if (--held_keys[code & ~USE_SHIFT] > 0)
+                return;
+
+            held_keys.erase(code & ~USE_SHIFT);
+            vk->send_key(code & ~(USE_SHIFT), WL_KEYBOARD_KEY_STATE_RELEASED);
+            vk->flush();
+        }
+
+        void Keyboard::decode_swipe(swipe_request_t request)
+        {
+            if (swipe_decoder)
+                swipe_decoder->decode(std::move(request));
+        }
+
+        void Keyboard::on_swipe_decoded(std::string word)
+        {
+            if (word.empty())
+                return;
+
+            vk->type_text(utf8_to_utf32(word.substr(1)) + U" ");
+            current_word = word;
+            end_word(true);
+        }
+
+        void Keyboard::update_word(uint32_t code)
+        {
+            if (!suggestion_bar && !correction)
+                return;
+
+            char32_t ch = get_key_char(code & ~USE_SHIFT, code & USE_SHIFT);
+            if (ch == '\b')
+            {
+                /* Erasing into the previous word loses track of it */
+                if (current_word.empty())
+                    return end_word(false);
+
+                current_word.pop_back();
+                word_nodes.pop_back();
+            } else if ((ch < 128) && (std::isalpha(ch) || (ch == '\'')))
+            {
+                if (current_word.empty())
+                {
+                    word_capitalized = std::isupper(ch) ||
+                        (vk->get_modifiers() & (MODIFIER_SHIFT | MODIFIER_LOCK));
+                }
+
+                /* Only the new letter is looked up */
+                current_word += std::tolower(ch);
+                uint32_t node = word_nodes.back();
+                if (completion && (node != CompletionTrie::NONE))
+                    node = completion->child(node, current_word.back());
+
+                word_nodes.push_back(node);
+            } else
+            {
+                /* Punctuation and other keys also end the sentence */
+                return end_word(ch == ' ');
+            }
+
+            show_suggestions();
+        }
+
+        void Keyboard::end_word(bool keep_context)
+        {
+            if (!suggestion_bar && !correction)
+                return;
+
+            if (user_dictionary && !current_word.empty())
+                user_dictionary->learn(current_word);
+
+            if (!keep_context)
+            {
+                previous_words[0] = previous_words[1] = NgramModel::NONE;
+            } else if (prediction && !current_word.empty())
+            {
+                previous_words[0] = previous_words[1];
+                previous_words[1] = prediction->find(current_word);
+            }
+
+            current_word.clear();
+            word_nodes = {CompletionTrie::ROOT};
+            show_suggestions();
+        }
+
+        void Keyboard::show_suggestions()
+        {
+            if (!suggestion_bar)
+                return;
+
+            std::vector<std::string> words;
+            if (!current_word.empty() && (completion || learned_words))
+            {
+                latency::scope_t timer(latency::STAGE_COMPLETE);
+                /* The user's own words come first */
+                if (learned_words)
+                {
+                    words = learned_words->complete(
+                        learned_words->find_prefix(current_word), current_word,
+                        SuggestionBar::SUGGESTIONS);
+                }
+
+                if (completion && (words.size() < SuggestionBar::SUGGESTIONS))
+                {
+                    for (auto& word : completion->complete(word_nodes.back(),
+                        current_word, SuggestionBar::SUGGESTIONS))
+                    {
+                        if ((words.size() < SuggestionBar::SUGGESTIONS) &&
+                            (std::find(words.begin(), words.end(), word) == words.end()))
+                        {
+                            words.push_back(word);
+                        }
+                    }
+                }
+            } else if (current_word.empty() && prediction)
+            {
+                prediction_t predicted[SuggestionBar::SUGGESTIONS];
+                size_t count;
+                {
+                    latency::scope_t timer(latency::STAGE_PREDICT);
+                    count = prediction->predict(previous_words[0],
+                        previous_words[1], predicted, SuggestionBar::SUGGESTIONS);
+                }
+
+                for (size_t i = 0; i < count; i++)
+                    words.emplace_back(predicted[i].word);
+            }
+
+            suggestion_bar->set_words(std::move(words));
+        }
+
+        void Keyboard::autocorrect(uint32_t code)
+        {
+            if (!correction || current_word.empty())
+                return;
+
+            /* A key with Ctrl, Alt or Super is a shortcut, it does not end
+             * the word as typed text */
+            if (vk->get_modifiers() & (MODIFIER_CTRL | MODIFIER_ALT | MODIFIER_SUPER))
+                return;
+
+            /* Words the user typed before are never corrected */
+            if (learned_words && (learned_words->child(
+                learned_words->find_prefix(current_word), 0) != CompletionTrie::NONE))
+            {
+                return;
+            }
+
+            /* Apostrophes are part of words */
+            char32_t ch = get_key_char(code & ~USE_SHIFT, code & USE_SHIFT);
+            if ((ch != ' ') && ((ch >= 128) || !std::ispunct(ch) || (ch == '\'')))
+                return;
+
+            std::string corrected;
+            {
+                latency::scope_t timer(latency::STAGE_CORRECT);
+                corrected = correction->correct(current_word);
+            }
+
+            if (corrected.empty())
+                return;
+
+            /* The word is ASCII, one backspace per byte */
+            std::u32string text(current_word.size(), U'\b');
+            /* The key ends the corrected word */
+            current_word = corrected;
+            if (word_capitalized && ((uint8_t)corrected[0] < 128))
+                corrected[0] = std::toupper(corrected[0]);
+
+            vk->type_text(text + utf8_to_utf32(corrected));
+        }
+
+        void Keyboard::load_learned_words()
+        {
+            auto& path = user_dictionary->get_trie_path();
+            if (access(path.c_str(), F_OK) == 0)
+                learned_words = std::make_unique<CompletionTrie>(path);
+        }
+
+        void Keyboard::accept_suggestion(const std::string& word)
+        {
+            if (word.size() < current_word.size())
+                return;
+
+            vk->type_text(utf8_to_utf32(word.substr(current_word.size())) + U" ");
+
+            /* word belongs to the suggestion bar, which end_word() clears */
+            current_word = word;
+            end_word(true);
+        }
+    }
+}
@@ -0,0 +1,289 @@
+#include "keymap.hpp"
+
+#include "shared/os-compatibility.h"
+
+#include <sstream>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <linux/input-event-codes.h>
+
+namespace wf
+{
+    struct keymap_key_t
+    {
+        uint32_t code;
+        const char *name;
+        const char *symbols;
+        /* characters typed without and with shift */
+        std::u32string_view text;
+    };
+
+    struct keymap_modifier_t
+    {
+        uint32_t code;
+        const char *modifier;
+    };
+
+    /* Defines keymap_keys, keymap_modifiers, keymap_types, keymap_compat */
+    #include "keymap.tpp"
+
+    /* xkb keycodes are evdev keycodes offset by 8 */
+    static const uint32_t XKB_EVDEV_OFFSET = 8;
+
+    std::string generate_keymap(const std::set<uint32_t>& keys,
+        const std::vector<char32_t>& slots)
+    {
+        auto wanted = keys;
+        for (auto& mod : keymap_modifiers)
+            wanted.insert(mod.code);
+
+        std::set<uint32_t> found;
+        std::ostringstream codes, symbols, modmap;
+        for (auto& key : keymap_keys)
+        {
+            if (!wanted.count(key.code))
+                continue;
+
+            found.insert(key.code);
+            codes << "        <" << key.name << "> = "
+                << key.code + XKB_EVDEV_OFFSET << ";\n";
+            /* Repeat is done by wf-osk itself */
+            symbols << "        key <" << key.name << "> { repeat= False, [ "
+                << key.symbols << " ] };\n";
+        }
+
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            if (!slots[i])
+                continue;
+
+            std::ostringstream name;
+            name << "S" << std::setw(3) << std::setfill('0') << i;
+            codes << "        <" << name.str() << "> = "
+                << KEYMAP_SLOT_BASE + i + XKB_EVDEV_OFFSET << ";\n";
+            symbols << "        key <" << name.str() << "> { repeat= False, [ U"
+                << std::hex << std::uppercase << std::setw(4) << std::setfill('0')
+                << uint32_t(slots[i]) << std::dec << " ] };\n";
+        }
+
+        for (auto& mod : keymap_modifiers)
+        {
+            for (auto& key : keymap_keys)
+            {
+                if (key.code == mod.code)
+                {
+                    modmap << "        modifier_map " << mod.modifier
+                        << " { <" << key.name << "> };\n";
+                }
+            }
+        }
+
+        for (auto& key : keys)
+        {
+            if (!found.count(key))
+                std::cerr << "No keymap entry for keycode " << key << std::endl;
+        }
+
+        std::ostringstream keymap;
+        keymap << "xkb_keymap {\n"
+            << "xkb_keycodes \"(unnamed)\" {\n"
+            << "        minimum = 8;\n"
+            << "        maximum = 255;\n"
+            << codes.str()
+            << "};\n"
+            << keymap_types
+            << keymap_compat
+            << "xkb_symbols \"(unnamed)\" {\n"
+            << symbols.str()
+            << modmap.str()
+            << "};\n"
+            << "};\n";
+
+        return keymap.str();
+    }
+
+    std::set<uint32_t> get_text_keys()
+    {
+        std::set<uint32_t> keys;
+        for (auto& key : keymap_keys)
+        {
+            if (!key.text.empty())
+                keys.insert(key.code);
+        }
+
+        return keys;
+    }
+
+    char32_t get_key_char(uint32_t code, bool shift)
+    {
+        for (auto& key : keymap_keys)
+        {
+            if ((key.code != code) || key.text.empty())
+                continue;
+
+            return key.text[std::min<size_t>(shift, key.text.size() - 1)];
+        }
+
+        return 0;
+    }
+
+    uint32_t get_key_code(std::string_view name)
+    {
+        for (auto& key : keymap_keys)
+        {
+            if (key.name == name)
+                return key.code;
+        }
+
+        return 0;
+    }
+
+    CharTable::CharTable(const std::set<uint32_t>& keys)
+    {
+        for (auto& key : keymap_keys)
+        {
+            if (!keys.count(key.code))
+                continue;
+
+            for (size_t level = 0; level < key.text.size(); level++)
+            {
+                keymap_char_t entry;
+                entry.code = key.code;
+                entry.modifiers = level ? uint32_t(MODIFIER_SHIFT) : 0;
+
+                /* The first key typing a character wins */
+                char32_t ch = key.text[level];
+                if (ch < 128)
+                {
+                    if (!ascii[ch].code)
+                        ascii[ch] = entry;
+                } else
+                {
+                    other.emplace(ch, entry);
+                }
+            }
+        }
+    }
+
+    const keymap_char_t *CharTable::find(char32_t ch) const
+    {
+        if (ch < 128)
+            return ascii[ch].code ? &ascii[ch] : nullptr;
+
+        auto it = other.find(ch);
+        return it == other.end() ? nullptr : &it->second;
+    }
+
+    /* Write the whole buffer into a sealed memfd, or return -1 if
+     * memfds or sealing are not supported */
+    static int create_sealed_file(const char *data, size_t size)
+    {
+#if defined(MFD_ALLOW_SEALING) && defined(F_ADD_SEALS)
+        int fd = memfd_create("wf-osk-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fd < 0)
+            return -1;
+
+        size_t written = 0;
+        while (written < size)
+        {
+            ssize_t ret = write(fd, data + written, size - written);
+            if (ret < 0 && errno == EINTR)
+                continue;
+
+            if (ret <= 0)
+            {
+                close(fd);
+                return -1;
+            }
+
+            written += ret;
+        }
+
+        if (fcntl(fd, F_ADD_SEALS,
+                F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+
+        return fd;
+#else
+        return -1;
+#endif
+    }
+
+    /* Fallback for systems without memfd sealing: an unlinked file in
+     * XDG_RUNTIME_DIR, filled through a temporary mapping */
+    static int create_shared_file(const char *data, size_t size)
+    {
+        int fd = os_create_anonymous_file(size);
+        if (fd < 0)
+            return -1;
+
+        void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            close(fd);
+            return -1;
+        }
+
+        std::memcpy(ptr, data, size);
+        munmap(ptr, size);
+        return fd;
+    }
+
+    KeymapFile::KeymapFile(const std::string& keymap)
+    {
+        this->size = keymap.size() + 1;
+        this->fd = create_sealed_file(keymap.c_str(), size);
+        if (fd < 0)
+            this->fd = create_shared_file(keymap.c_str(), size);
+
+        if (fd < 0)
+        {
+            std::cerr << "Failed to create keymap file: "
+                << std::strerror(errno) << std::endl;
+            std::exit(-1);
+        }
+    }
+
+    KeymapFile::~KeymapFile()
+    {
+        close(fd);
+    }
+
+    std::shared_ptr<KeymapFile> KeymapFile::get(const std::string& keymap)
+    {
+        /* Not kept alive here, the file is closed with the last device
+         * using it */
+        static std::string last_keymap;
+        static std::weak_ptr<KeymapFile> last_file;
+
+        auto file = last_file.lock();
+        if (!file || keymap != last_keymap)
+        {
+            file = std::shared_ptr<KeymapFile>(new KeymapFile(keymap));
+            last_file = file;
+            last_keymap = keymap;
+        }
+
+        return file;
+    }
+
+    int KeymapFile::get_fd() const
+    {
+        return fd;
+    }
+
+    size_t KeymapFile::get_size() const
+    {
+        return size;
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace wf
+{
+    /* Real modifier masks, matching the modifier_map of the keymap */
+    enum modifier_t : uint32_t
+    {
+        MODIFIER_SHIFT   = 1 << 0,
+        MODIFIER_LOCK    = 1 << 1,
+        MODIFIER_CTRL    = 1 << 2,
+        MODIFIER_ALT     = 1 << 3,
+        MODIFIER_NUMLOCK = 1 << 4,
+        MODIFIER_SUPER   = 1 << 6,
+    };
+
+    static constexpr int MODIFIER_BITS = 8;
+
+    /* Spare keycodes (KEY_F13 and up) which can be bound to any character,
+     * for typing text outside of the keymap table */
+    static constexpr uint32_t KEYMAP_SLOT_BASE = 183;
+    static constexpr int KEYMAP_SLOTS = 16;
+
+    /**
+     * Generate an xkb keymap which contains only the given keys
+     * (evdev keycodes, as in linux/input-event-codes.h) and the
+     * modifier keys. Keys unknown to the keymap table are skipped.
+     *
+     * slots[i] is the character typed by keycode KEYMAP_SLOT_BASE + i,
+     * 0 for unused slots.
+     */
+    std::string generate_keymap(const std::set<uint32_t>& keys,
+        const std::vector<char32_t>& slots = {});
+
+    /* Keys of the keymap table which type a character */
+    std::set<uint32_t> get_text_keys();
+
+    /* The character typed by a key, with or without shift, 0 if none */
+    char32_t get_key_char(uint32_t code, bool shift);
+
+    /* The keycode of a key of the keymap table by its xkb name, e.g.
+     * AD01 or SPCE, 0 if there is no such key */
+    uint32_t get_key_code(std::string_view name);
+
+    /* A key and the modifiers to hold while pressing it */
+    struct keymap_char_t
+    {
+        uint32_t code = 0;
+        uint32_t modifiers = 0;
+    };
+
+    /* Lookup table from characters to the keys typing them */
+    class CharTable
+    {
+        keymap_char_t ascii[128];
+        std::unordered_map<char32_t, keymap_char_t> other;
+
+        public:
+        /* Only characters typed by the given keys are added */
+        CharTable(const std::set<uint32_t>& keys);
+
+        /* nullptr if the character cannot be typed */
+        const keymap_char_t *find(char32_t ch) const;
+    };
+
+    /**
+     * A read-only file with the contents of a keymap, as sent to the
+     * compositor. It is a sealed memfd where available, so a single file
+     * can be handed out to every virtual keyboard using the same keymap.
+     */
+    class KeymapFile
+    {
+        int fd = -1;
+        size_t size = 0;
+
+        KeymapFile(const std::string& keymap);
+
+        public:
+        ~KeymapFile();
+        KeymapFile(const KeymapFile&) = delete;
+        KeymapFile& operator = (const KeymapFile&) = delete;
+
+        /* Get a file for the keymap, reusing the previous one if the
+         * contents are the same and it is still in use */
+        static std::shared_ptr<KeymapFile> get(const std::string& keymap);
+
+        int get_fd() const;
+        /* Size in bytes, including the terminating NUL */
+        size_t get_size() const;
+    };
+}
@@ -0,0 +1,227 @@
+#include "latency.hpp"
+
+#include <time.h>
+#include <csignal>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+#include <glib-unix.h>
+#include <gtk/gtk.h>
+
+namespace wf
+{
+    namespace latency
+    {
+        int histogram_t::bucket_index(uint64_t value)
+        {
+            if (value < SUB_BUCKETS)
+                return value;
+
+            int exponent = 63 - __builtin_clzll(value);
+            int shift = exponent - SUB_BUCKET_BITS;
+            int sub_bucket = (value >> shift) & (SUB_BUCKETS - 1);
+
+            return (shift + 1) * SUB_BUCKETS + sub_bucket;
+        }
+
+        uint64_t histogram_t::bucket_upper_bound(int index)
+        {
+            if (index < SUB_BUCKETS)
+                return index;
+
+            int shift = index / SUB_BUCKETS - 1;
+            uint64_t sub_bucket = index % SUB_BUCKETS;
+            uint64_t lower = (SUB_BUCKETS + sub_bucket) << shift;
+
+            return lower + ((uint64_t(1) << shift) - 1);
+        }
+
+        static void atomic_add(std::atomic<double>& target, double value)
+        {
+            double current = target.load(std::memory_order_relaxed);
+            while (!target.compare_exchange_weak(current, current + value,
+                std::memory_order_relaxed))
+            {}
+        }
+
+        void histogram_t::record(uint64_t value)
+        {
+            buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+            atomic_add(sum, value);
+            atomic_add(sum_squares, double(value) * value);
+        }
+
+        uint64_t histogram_t::count() const
+        {
+            uint64_t total = 0;
+            for (auto& bucket : buckets)
+                total += bucket.load(std::memory_order_relaxed);
+
+            return total;
+        }
+
+        double histogram_t::mean() const
+        {
+            uint64_t total = count();
+            return total ? sum.load(std::memory_order_relaxed) / total : 0;
+        }
+
+        double histogram_t::stddev() const
+        {
+            uint64_t total = count();
+            if (total < 2)
+                return 0;
+
+            double m = mean();
+            double variance = (sum_squares.load(std::memory_order_relaxed) -
+                total * m * m) / (total - 1);
+            return std::sqrt(std::max(variance, 0.0));
+        }
+
+        uint64_t histogram_t::percentile(double quantile) const
+        {
+            uint64_t total = count();
+            if (total == 0)
+                return 0;
+
+            uint64_t rank = quantile * (total - 1) + 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < BUCKETS; i++)
+            {
+                seen += buckets[i].load(std::memory_order_relaxed);
+                if (seen >= rank)
+                    return bucket_upper_bound(i);
+            }
+
+            return bucket_upper_bound(BUCKETS - 1);
+        }
+
+#ifdef OSK_LATENCY_STATS
+        static histogram_t histograms[STAGE_COUNT];
+
+        static const char *stage_names[STAGE_COUNT] = {
+            "dispatch", "keyboard-get", "autocorrect", "send-key", "flush",
+            "total", "suggest", "write",
+            "repeat-jitter", "layout-build", "init-layouts", "keymap",
+            "layout-switch", "draw", "hit-test", "swipe-decode",
+            "complete", "predict", "correct", "layout-load",
+        };
+
+        uint64_t now_ns()
+        {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+        }
+
+        void record(stage_t stage, uint64_t duration_ns)
+        {
+            histograms[stage].record(duration_ns);
+        }
+
+        const histogram_t& get_histogram(stage_t stage)
+        {
+            return histograms[stage];
+        }
+
+        const char *get_stage_name(stage_t stage)
+        {
+            return stage_names[stage];
+        }
+
+        void dump(std::ostream& out)
+        {
+            out << std::left << std::setw(14) << "stage"
+                << std::right << std::setw(10) << "count"
+                << std::setw(12) << "p50 (us)"
+                << std::setw(12) << "p99 (us)"
+                << std::setw(12) << "p999 (us)" << std::endl;
+
+            out << std::fixed << std::setprecision(1);
+            for (int i = 0; i < STAGE_COUNT; i++)
+            {
+                auto& hist = histograms[i];
+                out << std::left << std::setw(14) << stage_names[i]
+                    << std::right << std::setw(10) << hist.count()
+                    << std::setw(12) << hist.percentile(0.5) / 1000.0
+                    << std::setw(12) << hist.percentile(0.99) / 1000.0
+                    << std::setw(12) << hist.percentile(0.999) / 1000.0
+                    << std::endl;
+            }
+        }
+
+        void dump_json(std::ostream& out)
+        {
+            out << "{\"unit\": \"us\", \"stages\": [";
+            for (int i = 0; i < STAGE_COUNT; i++)
+            {
+                auto& hist = histograms[i];
+                out << (i ? ", " : "") << "{"
+                    << "\"name\": \"" << stage_names[i] << "\", "
+                    << "\"count\": " << hist.count() << ", "
+                    << "\"mean\": " << hist.mean() / 1000.0 << ", "
+                    << "\"stddev\": " << hist.stddev() / 1000.0 << ", "
+                    << "\"p50\": " << hist.percentile(0.5) / 1000.0 << ", "
+                    << "\"p99\": " << hist.percentile(0.99) / 1000.0 << ", "
+                    << "\"p999\": " << hist.percentile(0.999) / 1000.0 << "}";
+            }
+
+            out << "]}" << std::endl;
+        }
+
+        void install_signal_handler()
+        {
+            /* Runs from the main loop, not in signal context */
+            g_unix_signal_add(SIGUSR1, [] (gpointer) -> gboolean
+            {
+                dump(std::cerr);
+                return G_SOURCE_CONTINUE;
+            }, nullptr);
+        }
+
+        keystroke_t::keystroke_t()
+        {
+            start = last = now_ns();
+
+            /* GDK event times are CLOCK_MONOTONIC in milliseconds on
+             * wayland, truncated to 32 bits */
+            uint32_t event_ms = gtk_get_current_event_time();
+            uint32_t now_ms = start / 1000000;
+            if (event_ms != GDK_CURRENT_TIME && uint32_t(now_ms - event_ms) < 60000)
+                record(STAGE_DISPATCH, uint64_t(uint32_t(now_ms - event_ms)) * 1000000);
+        }
+
+        void keystroke_t::mark(stage_t stage)
+        {
+            uint64_t now = now_ns();
+            record(stage, now - last);
+            last = now;
+        }
+
+        void keystroke_t::finish()
+        {
+            if (!finished)
+                record(STAGE_TOTAL, now_ns() - start);
+
+            finished = true;
+        }
+
+        keystroke_t::~keystroke_t()
+        {
+            finish();
+        }
+
+        scope_t::scope_t(stage_t stage)
+        {
+            this->stage = stage;
+            this->start = now_ns();
+        }
+
+        scope_t::~scope_t()
+        {
+            record(stage, now_ns() - start);
+        }
+#endif
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+/* Keystroke latency and startup/switching cost instrumentation, enabled
+ * with -Dlatency_stats=true. When disabled, all of it compiles down to
+ * nothing. */
+namespace wf
+{
+    namespace latency
+    {
+        enum stage_t
+        {
+            /* GDK event time until KeyButton::on_pressed() */
+            STAGE_DISPATCH,
+            /* Keyboard::get() */
+            STAGE_KEYBOARD_GET,
+            /* correcting the word the key ends, typing the correction */
+            STAGE_AUTOCORRECT,
+            /* queueing the modifiers and key requests */
+            STAGE_SEND_KEY,
+            /* handing the key event to the writer thread */
+            STAGE_FLUSH,
+            /* Keyboard::get() until the key event is handed off */
+            STAGE_TOTAL,
+            /* following the word being typed and showing suggestions,
+             * after the key event is handed off */
+            STAGE_SUGGEST,
+            /* flush request until the writer thread wrote to the socket */
+            STAGE_WRITE,
+            /* key repeat timer expiry until the repeat is sent */
+            STAGE_REPEAT_JITTER,
+            /* construction of one KeyboardLayout */
+            STAGE_LAYOUT_BUILD,
+            /* Keyboard::init_layouts() */
+            STAGE_INIT_LAYOUTS,
+            /* generating the keymap and sending it */
+            STAGE_KEYMAP,
+            /* Keyboard::handle_action(), switching layouts */
+            STAGE_LAYOUT_SWITCH,
+            /* KeyboardCanvas::on_draw() */
+            STAGE_DRAW,
+            /* finding the key under a press on the canvas */
+            STAGE_HIT_TEST,
+            /* decoding a swipe into a word, on the decoder thread */
+            STAGE_SWIPE_DECODE,
+            /* completing the word being typed */
+            STAGE_COMPLETE,
+            /* predicting the next word */
+            STAGE_PREDICT,
+            /* looking up the correction of a finished word */
+            STAGE_CORRECT,
+            /* loading a layout file, through its cached image */
+            STAGE_LAYOUT_LOAD,
+            STAGE_COUNT,
+        };
+
+        /**
+         * A log-linear histogram of durations in nanoseconds: each power of
+         * two is split in SUB_BUCKETS linear buckets, giving a relative
+         * error below 1/SUB_BUCKETS. Recording is a few relaxed atomic
+         * operations, so it is safe from any thread.
+         */
+        class histogram_t
+        {
+            static constexpr int SUB_BUCKET_BITS = 4;
+            static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+            static constexpr int BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+            std::atomic<uint64_t> buckets[BUCKETS] = {};
+            /* For the mean and variance */
+            std::atomic<double> sum{0}, sum_squares{0};
+
+            static int bucket_index(uint64_t value);
+            static uint64_t bucket_upper_bound(int index);
+
+            public:
+            void record(uint64_t value);
+            uint64_t count() const;
+            double mean() const;
+            double stddev() const;
+            /* Upper bound of the bucket containing the given quantile */
+            uint64_t percentile(double quantile) const;
+        };
+
+#ifdef OSK_LATENCY_STATS
+        uint64_t now_ns();
+        void record(stage_t stage, uint64_t duration_ns);
+
+        /* Print p50/p99/p999 for every stage */
+        void dump(std::ostream& out);
+        /* Same as dump(), with mean and standard deviation, as JSON */
+        void dump_json(std::ostream& out);
+        /* Dump to stderr whenever SIGUSR1 is received */
+        void install_signal_handler();
+        /* A stage and its name, as printed, for the benchmarks */
+        const histogram_t& get_histogram(stage_t stage);
+        const char *get_stage_name(stage_t stage);
+
+        /* Timestamps of a key event going through the press path */
+        class keystroke_t
+        {
+            uint64_t start, last;
+            bool finished = false;
+
+            public:
+            /* Also records STAGE_DISPATCH from the current GDK event */
+            keystroke_t();
+            /* Record the time since the previous mark as the given stage */
+            void mark(stage_t stage);
+            /* Record STAGE_TOTAL, once the key event is handed off, the
+             * destructor does if this is not called */
+            void finish();
+            ~keystroke_t();
+        };
+
+        /* Records the lifetime of the object as the given stage */
+        class scope_t
+        {
+            stage_t stage;
+            uint64_t start;
+
+            public:
+            scope_t(stage_t stage);
+            ~scope_t();
+        };
+#else
+        inline void dump(std::ostream& out) {}
+        inline void dump_json(std::ostream& out) {}
+        inline void install_signal_handler() {}
+
+        class keystroke_t
+        {
+            public:
+            void mark(stage_t stage) {}
+            void finish() {}
+        };
+
+        class scope_t
+        {
+            public:
+            scope_t(stage_t stage) {}
+        };
+#endif
+    }
+}
@@ -0,0 +1,416 @@
+#include "layout-file.hpp"
+#include "keymap.hpp"
+#include "latency.hpp"
+
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace wf
+{
+    namespace osk
+    {
+        static const char *layout_names[LAYOUT_COUNT] = {
+            "default", "shift", "numeric",
+        };
+
+        static uint64_t fnv1a_64(std::string_view bytes)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (char c : bytes)
+                hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+
+            return hash;
+        }
+
+        /* Keycode of a key name of the layout file format, 0 if unknown */
+        static uint32_t parse_key_name(std::string_view name)
+        {
+            if (name == "abc")
+                return ABC_TOGGLE;
+            if (name == "numeric")
+                return NUM_TOGGLE;
+            if (name == "ctrl")
+                return MODIFIER_KEY | MODIFIER_CTRL;
+            if (name == "alt")
+                return MODIFIER_KEY | MODIFIER_ALT;
+            if (name == "super")
+                return MODIFIER_KEY | MODIFIER_SUPER;
+
+            static constexpr std::string_view shift_suffix = "+shift";
+            bool shift = (name.size() > shift_suffix.size()) &&
+                (name.substr(name.size() - shift_suffix.size()) == shift_suffix);
+            if (shift)
+                name.remove_suffix(shift_suffix.size());
+
+            uint32_t code = get_key_code(name);
+            return (code && shift) ? (code | USE_SHIFT) : code;
+        }
+
+        bool LayoutFile::compile(const std::string& text, const std::string& name,
+            std::string& image)
+        {
+            /* Keys of every row of every layout */
+            std::vector<std::vector<layout_key_t>> layout_rows[LAYOUT_COUNT];
+            bool defined[LAYOUT_COUNT] = {};
+            std::string labels;
+
+            int current = -1;
+            int line_number = 0;
+            std::istringstream lines(text);
+            std::string line;
+            auto fail = [&] (const std::string& message)
+            {
+                /* Errors about the whole file have no line */
+                std::cerr << name << ":";
+                if (line_number)
+                    std::cerr << line_number << ":";
+
+                std::cerr << " " << message << std::endl;
+                return false;
+            };
+
+            while (std::getline(lines, line))
+            {
+                line_number++;
+                std::istringstream fields(line);
+                std::string word;
+                if (!(fields >> word) || (word[0] == '#'))
+                    continue;
+
+                if (word == "layout")
+                {
+                    std::string layout;
+                    fields >> layout;
+                    current = -1;
+                    for (int i = 0; i < LAYOUT_COUNT; i++)
+                        current = (layout == layout_names[i]) ? i : current;
+
+                    if (current < 0)
+                        return fail("unknown layout \"" + layout + "\"");
+                    if (defined[current])
+                        return fail("layout " + layout + " is defined twice");
+
+                    defined[current] = true;
+                    continue;
+                }
+
+                if (current < 0)
+                    return fail("expected a layout");
+
+                if (word == "row")
+                {
+                    layout_rows[current].emplace_back();
+                    continue;
+                }
+
+                if (layout_rows[current].empty())
+                    return fail("expected a row");
+
+                layout_key_t key;
+                key.code = parse_key_name(word);
+                if (!key.code)
+                    return fail("unknown key \"" + word + "\"");
+
+                double width = 0;
+                if (!(fields >> width) || (width <= 0))
+                    return fail("expected a positive key width");
+
+                std::string label;
+                std::getline(fields >> std::ws, label);
+                while (!label.empty() && std::isspace((unsigned char)label.back()))
+                    label.pop_back();
+
+                key.width = width;
+                key.text_offset = labels.size();
+                key.text_length = label.size();
+                labels += label;
+                layout_rows[current].back().push_back(key);
+            }
+
+            line_number = 0;
+            for (int i = 0; i < LAYOUT_COUNT; i++)
+            {
+                if (layout_rows[i].empty())
+                    return fail(std::string("no rows in layout ") + layout_names[i]);
+
+                for (auto& row : layout_rows[i])
+                {
+                    if (row.empty())
+                        return fail(std::string("empty row in layout ") + layout_names[i]);
+                }
+            }
+
+            /* The shift layout reuses the widgets of the default one */
+            bool same_shape = (layout_rows[LAYOUT_SHIFT].size() ==
+                layout_rows[LAYOUT_DEFAULT].size());
+            for (size_t i = 0; same_shape && (i < layout_rows[LAYOUT_SHIFT].size()); i++)
+            {
+                same_shape = (layout_rows[LAYOUT_SHIFT][i].size() ==
+                    layout_rows[LAYOUT_DEFAULT][i].size());
+            }
+
+            if (!same_shape)
+                return fail("the shift layout does not have the rows of the default layout");
+
+            layout_image_header_t header = {};
+            std::memcpy(header.magic, LAYOUT_MAGIC, sizeof(LAYOUT_MAGIC));
+            std::vector<uint32_t> row_start;
+            std::vector<layout_key_t> keys;
+            for (int i = 0; i < LAYOUT_COUNT; i++)
+            {
+                header.layout_start[i] = row_start.size();
+                for (auto& row : layout_rows[i])
+                {
+                    row_start.push_back(keys.size());
+                    keys.insert(keys.end(), row.begin(), row.end());
+                }
+            }
+
+            row_start.push_back(keys.size());
+            header.layout_start[LAYOUT_COUNT] = header.row_count = row_start.size() - 1;
+            header.key_count = keys.size();
+            header.text_size = labels.size();
+
+            image.assign((const char*)&header, sizeof(header));
+            image.append((const char*)row_start.data(), row_start.size() * 4);
+            image.append((const char*)keys.data(), keys.size() * sizeof(layout_key_t));
+            image += labels;
+            return true;
+        }
+
+        bool LayoutFile::use_image(const char *bytes, size_t size)
+        {
+            layout_image_header_t header;
+            if (size < sizeof(header))
+                return false;
+
+            std::memcpy(&header, bytes, sizeof(header));
+            uint64_t expected = sizeof(header) + 4 * (uint64_t(header.row_count) + 1) +
+                sizeof(layout_key_t) * uint64_t(header.key_count) + header.text_size;
+            if (std::memcmp(header.magic, LAYOUT_MAGIC, sizeof(LAYOUT_MAGIC)) ||
+                (expected != size) || (header.layout_start[0] != 0) ||
+                (header.layout_start[LAYOUT_COUNT] != header.row_count))
+            {
+                return false;
+            }
+
+            auto row_start = (const uint32_t*)(bytes + sizeof(header));
+            auto image_keys = (const layout_key_t*)(row_start + header.row_count + 1);
+            auto text = (const char*)(image_keys + header.key_count);
+
+            /* Everything the tables point to is checked once here, so that
+             * a damaged cache cannot crash the keyboard later */
+            if ((row_start[0] != 0) || (row_start[header.row_count] != header.key_count))
+                return false;
+
+            for (uint32_t i = 0; i < header.row_count; i++)
+            {
+                if (row_start[i] >= row_start[i + 1])
+                    return false;
+            }
+
+            for (int i = 0; i < LAYOUT_COUNT; i++)
+            {
+                if (header.layout_start[i] >= header.layout_start[i + 1])
+                    return false;
+            }
+
+            uint32_t default_rows = header.layout_start[LAYOUT_DEFAULT + 1];
+            uint32_t shift_start = header.layout_start[LAYOUT_SHIFT];
+            if (header.layout_start[LAYOUT_SHIFT + 1] - shift_start != default_rows)
+                return false;
+
+            for (uint32_t i = 0; i < default_rows; i++)
+            {
+                if (row_start[i + 1] - row_start[i] !=
+                    row_start[shift_start + i + 1] - row_start[shift_start + i])
+                {
+                    return false;
+                }
+            }
+
+            keys.resize(header.key_count);
+            for (uint32_t i = 0; i < header.key_count; i++)
+            {
+                auto& key = image_keys[i];
+                if ((key.text_offset > header.text_size) ||
+                    (key.text_length > header.text_size - key.text_offset) ||
+                    !(key.width > 0))
+                {
+                    return false;
+                }
+
+                keys[i].code = key.code;
+                keys[i].text = std::string_view(text + key.text_offset, key.text_length);
+                keys[i].width = key.width;
+            }
+
+            rows.resize(header.row_count);
+            for (uint32_t i = 0; i < header.row_count; i++)
+                rows[i] = {keys.data() + row_start[i], row_start[i + 1] - row_start[i]};
+
+            for (int i = 0; i < LAYOUT_COUNT; i++)
+            {
+                layouts[i] = {rows.data() + header.layout_start[i],
+                    header.layout_start[i + 1] - header.layout_start[i]};
+            }
+
+            return true;
+        }
+
+        bool LayoutFile::map_image(const std::string& path, int64_t mtime_ns,
+            uint64_t source_size, const uint64_t *hash)
+        {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if ((fd < 0) || (fstat(fd, &st) < 0) ||
+                (size_t(st.st_size) < sizeof(layout_image_header_t)))
+            {
+                if (fd >= 0)
+                    close(fd);
+
+                return false;
+            }
+
+            size = st.st_size;
+            data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (data == MAP_FAILED)
+            {
+                data = nullptr;
+                return false;
+            }
+
+            auto header = (const layout_image_header_t*)data;
+            bool same_source = hash ? (header->source_hash == *hash) :
+                ((header->source_mtime_ns == mtime_ns) &&
+                    (header->source_size == source_size));
+            if (!same_source || !use_image((const char*)data, size))
+            {
+                munmap((void*)data, size);
+                data = nullptr;
+                return false;
+            }
+
+            return true;
+        }
+
+        /* Create the directory and its missing parents */
+        static void make_directories(const std::string& path)
+        {
+            for (size_t end = path.find('/', 1); ; end = path.find('/', end + 1))
+            {
+                mkdir(path.substr(0, end).c_str(), 0755);
+                if (end == std::string::npos)
+                    return;
+            }
+        }
+
+        /* $XDG_CACHE_HOME/wf-osk, or ~/.cache/wf-osk */
+        static std::string get_cache_directory()
+        {
+            const char *cache_home = getenv("XDG_CACHE_HOME");
+            if (cache_home && *cache_home)
+                return std::string(cache_home) + "/wf-osk";
+
+            const char *home = getenv("HOME");
+            return std::string(home ? home : "") + "/.cache/wf-osk";
+        }
+
+        LayoutFile::LayoutFile(const std::string& path)
+        {
+            latency::scope_t timer(latency::STAGE_LAYOUT_LOAD);
+            struct stat st;
+            char real_path[PATH_MAX];
+            if ((stat(path.c_str(), &st) < 0) || !realpath(path.c_str(), real_path))
+            {
+                std::cerr << "Failed to open the layout file " << path << std::endl;
+                std::exit(-1);
+            }
+
+            /* One image per layout file */
+            std::ostringstream cache_name;
+            cache_name << get_cache_directory() << "/layout-" << std::hex
+                << fnv1a_64(real_path) << ".bin";
+            std::string cache_path = cache_name.str();
+
+            int64_t mtime_ns = st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+            if (map_image(cache_path, mtime_ns, st.st_size, nullptr))
+                return;
+
+            std::ifstream file(path, std::ios::binary);
+            std::string text((std::istreambuf_iterator<char>(file)),
+                std::istreambuf_iterator<char>());
+            if (!file)
+            {
+                std::cerr << "Failed to read the layout file " << path << std::endl;
+                std::exit(-1);
+            }
+
+            /* A touched or copied file does not need a new image, the
+             * image records the new mtime so that the next start does not
+             * read the file */
+            uint64_t hash = fnv1a_64(text);
+            if (map_image(cache_path, mtime_ns, st.st_size, &hash))
+            {
+                layout_image_header_t header;
+                std::memcpy(&header, data, sizeof(header));
+                header.source_mtime_ns = mtime_ns;
+                header.source_size = st.st_size;
+
+                int fd = open(cache_path.c_str(), O_WRONLY | O_CLOEXEC);
+                if ((fd < 0) || (pwrite(fd, &header, sizeof(header), 0) < 0))
+                    std::cerr << "Failed to update " << cache_path << std::endl;
+
+                if (fd >= 0)
+                    close(fd);
+
+                return;
+            }
+
+            if (!compile(text, path, image))
+                std::exit(-1);
+
+            auto header = (layout_image_header_t*)&image[0];
+            header->source_mtime_ns = mtime_ns;
+            header->source_size = st.st_size;
+            header->source_hash = hash;
+
+            /* Written under another name first, so that other instances
+             * never map a partial image */
+            make_directories(get_cache_directory());
+            std::string new_path = cache_path + ".new";
+            std::ofstream cache(new_path, std::ios::binary | std::ios::trunc);
+            cache.write(image.data(), image.size());
+            cache.close();
+            if (!cache || (rename(new_path.c_str(), cache_path.c_str()) < 0))
+            {
+                std::cerr << "Failed to write the layout cache " << cache_path << std::endl;
+                unlink(new_path.c_str());
+            }
+
+            use_image(image.data(), image.size());
+        }
+
+        LayoutFile::~LayoutFile()
+        {
+            if (data)
+                munmap((void*)data, size);
+        }
+
+        const LayoutTable& LayoutFile::get(layout_id_t id) const
+        {
+            return layouts[id];
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "layout.hpp"
+
+namespace wf
+{
+    namespace osk
+    {
+        /**
+         * Header of a compiled layout image, followed by, in this order:
+         *
+         *   uint32_t row_start[row_count + 1]   into keys
+         *   layout_key_t keys[key_count]
+         *   char text[text_size]
+         *
+         * The image is in host byte order. The source fields identify the
+         * layout file it was compiled from.
+         */
+        struct layout_image_header_t
+        {
+            char magic[8];
+            int64_t source_mtime_ns;
+            uint64_t source_size;
+            /* FNV-1a of the contents */
+            uint64_t source_hash;
+            /* First row of each layout_id_t, and row_count */
+            uint32_t layout_start[LAYOUT_COUNT + 1];
+            uint32_t row_count;
+            uint32_t key_count;
+            uint32_t text_size;
+            uint32_t reserved;
+        };
+
+        struct layout_key_t
+        {
+            uint32_t code;
+            float width;
+            /* The label, in text */
+            uint32_t text_offset;
+            uint32_t text_length;
+        };
+
+        static_assert(sizeof(layout_key_t) == 16,
+            "layout_key_t is part of the image format");
+
+        static constexpr char LAYOUT_MAGIC[8] = {'W', 'F', 'O', 'S', 'K', 'L', 'Y', '1'};
+
+        /**
+         * Layouts loaded from a text file instead of the built-in tables.
+         * The file lists the keys of every layout_id_t:
+         *
+         *   # A comment
+         *   layout default     Start a layout: default, shift or numeric
+         *   row                Start a row of the current layout
+         *   AD01 1 q           A key: its name, width and label
+         *
+         * Key names are the xkb names of the keymap table, e.g. AD01 or
+         * SPCE, with +shift appended for keys typed with shift, or one of
+         * abc (toggles shift), numeric (shows the numeric layout), ctrl,
+         * alt and super. The label is the rest of the line. The shift
+         * layout has the same rows and number of keys as the default one.
+         * layouts/default.layout has the built-in layouts.
+         *
+         * The text is compiled into an image on first load, which is
+         * cached in $XDG_CACHE_HOME/wf-osk. Later loads map the image and
+         * only check its bounds. The cache is used while the file keeps
+         * its mtime and size, or else its contents.
+         */
+        class LayoutFile
+        {
+            const void *data = nullptr;
+            size_t size = 0;
+            /* The image when it could not be cached */
+            std::string image;
+
+            std::vector<Key> keys;
+            std::vector<KeyRowTable> rows;
+            LayoutTable layouts[LAYOUT_COUNT];
+
+            /* Map the cached image if it was compiled from the file, or
+             * from a file with the same contents if hash is set */
+            bool map_image(const std::string& path, int64_t mtime_ns,
+                uint64_t source_size, const uint64_t *hash);
+            /* Point the tables into a checked image */
+            bool use_image(const char *bytes, size_t size);
+
+            public:
+            /* Load the file, exits if it is missing or invalid */
+            LayoutFile(const std::string& path);
+            ~LayoutFile();
+            LayoutFile(const LayoutFile&) = delete;
+            LayoutFile& operator = (const LayoutFile&) = delete;
+
+            const LayoutTable& get(layout_id_t id) const;
+
+            /**
+             * Compile the text of a layout file into an image, without
+             * its source fields. Prints the first error with the name of
+             * the file and returns false if the text is invalid.
+             */
+            static bool compile(const std::string& text, const std::string& name,
+                std::string& image);
+        };
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#define ABC_TOGGLE 0x12345678
+#define NUM_TOGGLE 0x87654321
+
+#define IS_COMMAND(x) ((x) == ABC_TOGGLE || (x) == NUM_TOGGLE)
+
+#define USE_SHIFT  0x10000000
+/* Modifier keys, the low bits are a wf::modifier_t */
+#define MODIFIER_KEY 0x20000000
+
+#define IS_MODIFIER(x) (!IS_COMMAND(x) && ((x) & MODIFIER_KEY))
+
+namespace wf
+{
+    namespace osk
+    {
+        struct Key
+        {
+            uint32_t code = 0;
+            std::string_view text;
+            double width = 0;
+        };
+
+        /* A row of a layout table */
+        struct KeyRowTable
+        {
+            const Key *keys;
+            size_t count;
+
+            const Key *begin() const { return keys; }
+            const Key *end() const { return keys + count; }
+            size_t size() const { return count; }
+        };
+
+        /* A layout table, either static (see layouts.tpp) or loaded from
+         * a layout file */
+        struct LayoutTable
+        {
+            const KeyRowTable *rows;
+            size_t count;
+
+            const KeyRowTable *begin() const { return rows; }
+            const KeyRowTable *end() const { return rows + count; }
+            size_t size() const { return count; }
+        };
+
+        /* The layouts the keyboard switches between */
+        enum layout_id_t
+        {
+            LAYOUT_DEFAULT,
+            /* Same rows and number of keys as the default layout */
+            LAYOUT_SHIFT,
+            LAYOUT_NUMERIC,
+            LAYOUT_COUNT,
+        };
+    }
+}
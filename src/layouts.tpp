@@ -1,118 +1,141 @@
-std::vector<std::vector<Key>> default_keys = {
-    {
-        {KEY_Q, "q", 1},
-        {KEY_W, "w", 1},
-        {KEY_E, "e", 1},
-        {KEY_R, "r", 1},
-        {KEY_T, "t", 1},
-        {KEY_Y, "y", 1},
-        {KEY_U, "u", 1},
-        {KEY_I, "i", 1},
-        {KEY_O, "o", 1},
-        {KEY_P, "p", 1},
-        {KEY_BACKSPACE, "⌫", 2}
-    },
-    {
-        {KEY_TAB, "⇥", 0.5},
-        {KEY_A, "a", 1},
-        {KEY_S, "s", 1},
-        {KEY_D, "d", 1},
-        {KEY_F, "f", 1},
-        {KEY_G, "g", 1},
-        {KEY_H, "h", 1},
-        {KEY_J, "j", 1},
-        {KEY_K, "k", 1},
-        {KEY_L, "l", 1},
-        {KEY_ENTER, "↵", 2}
-    },
-    {
-        {ABC_TOGGLE, "ABC", 1},
-        {KEY_Z, "z", 1},
-        {KEY_X, "x", 1},
-        {KEY_C, "c", 1},
-        {KEY_V, "v", 1},
-        {KEY_B, "b", 1},
-        {KEY_N, "n", 1},
-        {KEY_M, "m", 1},
-        {KEY_COMMA, ",", 1},
-        {KEY_DOT, ".", 1}
-    },
-    {
-        {NUM_TOGGLE, "123?", 1.5},
-        {KEY_SPACE, "_", 9.5},
-        {KEY_LEFT, "←", 0.5},
-        {KEY_RIGHT, "→", 0.5},
-        {KEY_UP, "↑", 0.5},
-        {KEY_DOWN, "↓", 0.5}
-    }
+/* Key layouts, as static tables. The shift layout is derived from the
+ * default one at compile time, see shifted_row(). */
+
+static constexpr Key default_row1[] = {
+    {KEY_Q, "q", 1},
+    {KEY_W, "w", 1},
+    {KEY_E, "e", 1},
+    {KEY_R, "r", 1},
+    {KEY_T, "t", 1},
+    {KEY_Y, "y", 1},
+    {KEY_U, "u", 1},
+    {KEY_I, "i", 1},
+    {KEY_O, "o", 1},
+    {KEY_P, "p", 1},
+    {KEY_BACKSPACE, "⌫", 2}
+};
+
+static constexpr Key default_row2[] = {
+    {KEY_TAB, "⇥", 0.5},
+    {KEY_A, "a", 1},
+    {KEY_S, "s", 1},
+    {KEY_D, "d", 1},
+    {KEY_F, "f", 1},
+    {KEY_G, "g", 1},
+    {KEY_H, "h", 1},
+    {KEY_J, "j", 1},
+    {KEY_K, "k", 1},
+    {KEY_L, "l", 1},
+    {KEY_ENTER, "↵", 2}
+};
+
+static constexpr Key default_row3[] = {
+    {ABC_TOGGLE, "ABC", 1},
+    {KEY_Z, "z", 1},
+    {KEY_X, "x", 1},
+    {KEY_C, "c", 1},
+    {KEY_V, "v", 1},
+    {KEY_B, "b", 1},
+    {KEY_N, "n", 1},
+    {KEY_M, "m", 1},
+    {KEY_COMMA, ",", 1},
+    {KEY_DOT, ".", 1}
 };
 
-auto shift_keys = default_keys;
-for (auto& row : shift_keys)
-{
-    for (auto& key : row)
-    {
-        key.text = key.text.uppercase();
-        if (key.code < USE_SHIFT)
-            key.code |= USE_SHIFT;
+static constexpr Key default_row4[] = {
+    {NUM_TOGGLE, "123?", 1.5},
+    {MODIFIER_KEY | MODIFIER_CTRL, "Ctrl", 1},
+    {MODIFIER_KEY | MODIFIER_ALT, "Alt", 1},
+    {KEY_SPACE, "_", 7.5},
+    {KEY_LEFT, "←", 0.5},
+    {KEY_RIGHT, "→", 0.5},
+    {KEY_UP, "↑", 0.5},
+    {KEY_DOWN, "↓", 0.5}
+};
+
+static constexpr auto shift_row1 = shifted_row(default_row1);
+static constexpr auto shift_row2 = shifted_row(default_row2);
+static constexpr auto shift_row3 = shifted_row(default_row3);
+static constexpr auto shift_row4 = shifted_row(default_row4);
 
-        if (key.text == "ABC")
-            key.text = "abc";
-    }
-}
+static constexpr Key numeric_row1[] = {
+    {KEY_1, "1", 1},
+    {KEY_2, "2", 1},
+    {KEY_3, "3", 1},
+    {KEY_4, "4", 1},
+    {KEY_5, "5", 1},
+    {KEY_6, "6", 1},
+    {KEY_7, "7", 1},
+    {KEY_8, "8", 1},
+    {KEY_9, "9", 1},
+    {KEY_0, "0", 1},
+    {KEY_MINUS, "-", 1},
+    {KEY_EQUAL, "=", 1},
+    {KEY_BACKSPACE, "⌫", 2}
+};
+
+static constexpr Key numeric_row2[] = {
+    {KEY_1 | USE_SHIFT, "!", 1},
+    {KEY_2 | USE_SHIFT, "@", 1},
+    {KEY_3 | USE_SHIFT, "#", 1},
+    {KEY_4 | USE_SHIFT, "$", 1},
+    {KEY_5 | USE_SHIFT, "%", 1},
+    {KEY_6 | USE_SHIFT, "^", 1},
+    {KEY_7 | USE_SHIFT, "&", 1},
+    {KEY_8 | USE_SHIFT, "*", 1},
+    {KEY_9 | USE_SHIFT, "(", 1},
+    {KEY_0 | USE_SHIFT, ")", 1},
+    {KEY_SEMICOLON, ";", 1},
+    {KEY_SEMICOLON | USE_SHIFT, ":", 1},
+    {KEY_ENTER, "↵", 3}
+};
 
-std::vector<std::vector<Key>> numeric_keys = {
-    {
-        {KEY_1, "1", 1},
-        {KEY_2, "2", 1},
-        {KEY_3, "3", 1},
-        {KEY_4, "4", 1},
-        {KEY_5, "5", 1},
-        {KEY_6, "6", 1},
-        {KEY_7, "7", 1},
-        {KEY_8, "8", 1},
-        {KEY_9, "9", 1},
-        {KEY_0, "0", 1},
-        {KEY_MINUS, "-", 1},
-        {KEY_EQUAL, "=", 1},
-        {KEY_BACKSPACE, "⌫", 2}
-    },
-    {
-        {KEY_1 | USE_SHIFT, "!", 1},
-        {KEY_2 | USE_SHIFT, "@", 1},
-        {KEY_3 | USE_SHIFT, "#", 1},
-        {KEY_4 | USE_SHIFT, "$", 1},
-        {KEY_5 | USE_SHIFT, "%", 1},
-        {KEY_6 | USE_SHIFT, "^", 1},
-        {KEY_7 | USE_SHIFT, "&", 1},
-        {KEY_8 | USE_SHIFT, "*", 1},
-        {KEY_9 | USE_SHIFT, "(", 1},
-        {KEY_0 | USE_SHIFT, ")", 1},
-        {KEY_SEMICOLON, ";", 1},
-        {KEY_SEMICOLON | USE_SHIFT, ":", 1},
-        {KEY_ENTER, "↵", 3}
-    },
-    {
-        {KEY_LEFTBRACE, "[", 1},
-        {KEY_RIGHTBRACE, "]", 1},
-        {KEY_LEFTBRACE | USE_SHIFT, "{", 1},
-        {KEY_RIGHTBRACE | USE_SHIFT, "}", 1},
-        {KEY_COMMA | USE_SHIFT, "<", 1},
-        {KEY_DOT | USE_SHIFT, ">", 1},
-        {KEY_EQUAL | USE_SHIFT, "+", 1},
-        {KEY_SLASH, "/", 1},
-        {KEY_SLASH | USE_SHIFT, "?", 1},
-        {KEY_APOSTROPHE, "\'", 1},
-        {KEY_APOSTROPHE | USE_SHIFT, "\"", 1},
-        {KEY_GRAVE, "`", 1},
-        {KEY_GRAVE | USE_SHIFT, "~", 1},
-        {KEY_COMMA, ",", 1},
-        {KEY_DOT, ".", 1}
-    },
-    {
-        {ABC_TOGGLE, "abc", 1},
-        {KEY_SPACE, "_", 10},
-        {KEY_BACKSLASH, "\\", 1},
-        {KEY_BACKSLASH | USE_SHIFT, "|", 1}
-    }
+static constexpr Key numeric_row3[] = {
+    {KEY_LEFTBRACE, "[", 1},
+    {KEY_RIGHTBRACE, "]", 1},
+    {KEY_LEFTBRACE | USE_SHIFT, "{", 1},
+    {KEY_RIGHTBRACE | USE_SHIFT, "}", 1},
+    {KEY_COMMA | USE_SHIFT, "<", 1},
+    {KEY_DOT | USE_SHIFT, ">", 1},
+    {KEY_EQUAL | USE_SHIFT, "+", 1},
+    {KEY_SLASH, "/", 1},
+    {KEY_SLASH | USE_SHIFT, "?", 1},
+    {KEY_APOSTROPHE, "\'", 1},
+    {KEY_APOSTROPHE | USE_SHIFT, "\"", 1},
+    {KEY_GRAVE, "`", 1},
+    {KEY_GRAVE | USE_SHIFT, "~", 1},
+    {KEY_COMMA, ",", 1},
+    {KEY_DOT, ".", 1}
 };
+
+static constexpr Key numeric_row4[] = {
+    {ABC_TOGGLE, "abc", 1},
+    {KEY_SPACE, "_", 10},
+    {KEY_BACKSLASH, "\\", 1},
+    {KEY_BACKSLASH | USE_SHIFT, "|", 1}
+};
+
+static constexpr KeyRowTable default_rows[] = {
+    make_row(default_row1),
+    make_row(default_row2),
+    make_row(default_row3),
+    make_row(default_row4)
+};
+
+static constexpr KeyRowTable shift_rows[] = {
+    make_row(shift_row1),
+    make_row(shift_row2),
+    make_row(shift_row3),
+    make_row(shift_row4)
+};
+
+static constexpr KeyRowTable numeric_rows[] = {
+    make_row(numeric_row1),
+    make_row(numeric_row2),
+    make_row(numeric_row3),
+    make_row(numeric_row4)
+};
+
+static constexpr LayoutTable default_keys = make_layout(default_rows);
+static constexpr LayoutTable shift_keys = make_layout(shift_rows);
+static constexpr LayoutTable numeric_keys = make_layout(numeric_rows);
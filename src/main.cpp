@@ -1,180 +1,96 @@
 #include "osk.hpp"
+#include "keymap.hpp"
+#include "latency.hpp"
 #include <getopt.h>
 #include <iostream>
-#include <linux/input-event-codes.h>
+#include <fstream>
+#include <algorithm>
 
 #include "util/clara.hpp"
 
-#define ABC_TOGGLE 0x12345678
-#define NUM_TOGGLE 0x87654321
-
-#define IS_COMMAND(x) ((x) == ABC_TOGGLE || (x) == NUM_TOGGLE)
-
-#define USE_SHIFT  0x10000000
-
-namespace wf
+static void print_stats(const wf::emission_stats_t& stats)
 {
-    namespace osk
+    double events = std::max<uint64_t>(stats.key_events, 1);
+    std::cout << "key events: " << stats.key_events
+        << ", requests: " << stats.requests
+        << " (" << stats.requests / events << " per key event)"
+        << ", flushes: " << stats.flushes
+        << " (" << stats.flushes / events << " per key event)" << std::endl;
+
+    if (stats.characters)
     {
-        int spacing = OSK_SPACING;
-        int default_width = 800;
-        int default_height = 400;
-        int headerbar_size = 60;
-
-        std::string anchor;
-
-        KeyButton::KeyButton(Key key, int width, int height)
-        {
-            this->code = key.code;
-
-            this->button.set_size_request(width, height);
-            this->button.set_label(key.text);
-
-            this->button.signal_pressed().connect_notify(
-                sigc::mem_fun(this, &KeyButton::on_pressed));
-            this->button.signal_released().connect_notify(
-                sigc::mem_fun(this, &KeyButton::on_released));
-        }
-
-        void KeyButton::on_pressed()
-        {
-            auto& keyboard = Keyboard::get();
-            if (IS_COMMAND(this->code))
-                return;
-
-            if (this->code & USE_SHIFT)
-                keyboard.get_device().set_shift(true);
-
-            keyboard.get_device().send_key(this->code & ~(USE_SHIFT),
-                WL_KEYBOARD_KEY_STATE_PRESSED);
-        }
-
-        void KeyButton::on_released()
-        {
-            auto& keyboard = Keyboard::get();
-            if (IS_COMMAND(this->code))
-                return keyboard.handle_action(this->code);
-
-            if (this->code & USE_SHIFT)
-                keyboard.get_device().set_shift(false);
-
-            keyboard.get_device().send_key(this->code & ~(USE_SHIFT),
-                WL_KEYBOARD_KEY_STATE_RELEASED);
-        }
-
-        KeyboardRow::KeyboardRow(std::vector<Key> keys,
-            int width, int height)
-        {
-            double sum = 0;
-            for (auto& key : keys)
-                sum += key.width;
-
-            box.set_spacing(spacing);
-            int total_spacing = std::min((int)keys.size() - 1, 0) * spacing;
-            int total_buttons = width - total_spacing;
-
-            for (auto& key : keys)
-            {
-                this->keys.emplace_back(std::make_unique<KeyButton>
-                    (key, int(key.width / sum * total_buttons), height));
-                this->box.pack_start(this->keys.back()->button);
-            }
-        }
-
-        KeyboardLayout::KeyboardLayout(std::vector<std::vector<Key>> keys,
-            int32_t width, int32_t height)
-        {
-            box.set_spacing(spacing);
-            int total_spacing = std::min((int)keys.size() - 1, 0) * spacing;
-
-            int row_height = (height - total_spacing) / keys.size();
-            for (auto& row : keys)
-            {
-                this->rows.emplace_back(
-                    std::make_unique<KeyboardRow> (row, width, row_height));
-                this->box.pack_start(this->rows.back()->box);
-            }
-        }
-
-        void Keyboard::init_layouts()
-        {
-            /* Key layouts are defined in layouts.tpp,
-             * it defines default_keys, shift_keys, numeric_keys */
-            #include "layouts.tpp"
-
-            this->default_layout = std::make_unique<KeyboardLayout>
-                (default_keys, default_width, default_height);
-
-            this->shift_layout = std::make_unique<KeyboardLayout>
-                (shift_keys, default_width, default_height);
-
-            this->numeric_layout = std::make_unique<KeyboardLayout>
-                (numeric_keys, default_width, default_height);
-        }
-
-        void Keyboard::set_layout(KeyboardLayout *new_layout)
-        {
-            this->current_layout = new_layout;
-            window->set_widget(new_layout->box);
-        }
-
-        Keyboard::Keyboard()
-        {
-            window = std::make_unique<WaylandWindow>
-                (default_width, default_height, anchor, headerbar_size);
-            vk = std::make_unique<VirtualKeyboardDevice> ();
-
-            init_layouts();
-            set_layout(default_layout.get());
-        }
+        std::cout << "characters typed: " << stats.characters
+            << ", keymap uploads: " << stats.keymap_uploads
+            << " (" << stats.keymap_uploads * 1000.0 / stats.characters
+            << " per 1000 characters)" << std::endl;
+    }
+}
 
-        std::unique_ptr<Keyboard> Keyboard::instance;
-        void Keyboard::create()
-        {
-            if (instance)
-                throw std::logic_error("Creating keyboard twice!");
+static void print_render_stats(const wf::osk::render_stats_t& stats)
+{
+    double events = std::max<uint64_t>(stats.key_events, 1);
+    double per_event = stats.repainted_pixels / events;
+    double surface = std::max<uint64_t>(stats.surface_pixels, 1);
+    std::cout << "most keys held at once: " << stats.max_presses << std::endl;
+    std::cout << "damaged per key event: "
+        << 100.0 * stats.damaged_pixels / events / surface << "% of the surface"
+        << std::endl;
+    std::cout << "draws: " << stats.draws
+        << ", repainted pixels: " << stats.repainted_pixels
+        << " (" << per_event << " per key event, "
+        << 100.0 * per_event / surface << "% of the surface)" << std::endl;
+
+    uint64_t lookups = stats.sprite_hits + stats.sprite_misses;
+    std::cout << "key sprites: " << stats.sprite_misses << " rendered"
+        << ", hit rate: " << 100.0 * stats.sprite_hits / std::max<uint64_t>(lookups, 1)
+        << "%, memory: " << stats.sprite_bytes / 1024 << " KiB" << std::endl;
+}
 
-            instance = std::unique_ptr<Keyboard>(new Keyboard());
-        }
+static void print_learning_stats(const wf::osk::learning_stats_t& stats)
+{
+    double appended = std::max<uint64_t>(stats.appended_bytes, 1);
+    std::cout << "learned words: " << stats.appended_bytes << " bytes appended, "
+        << stats.compactions << " compactions writing " << stats.compacted_bytes
+        << " bytes in " << stats.compaction_ns / 1000000.0 << " ms, "
+        << "write amplification: "
+        << (stats.appended_bytes + stats.compacted_bytes) / appended << std::endl;
+}
 
-        Keyboard& Keyboard::get()
+/* Type the text with the running keyboard, or with a virtual keyboard
+ * of our own if there is none, without showing the keyboard */
+static int run_type_text(const std::string& text, bool show_stats)
+{
+    size_t missing = 0;
+    if (!wf::osk::TextServer::send_text(text, missing))
+    {
         {
-            if (!instance)
-                throw std::logic_error("Getting keyboard before creating it!");
+            wf::VirtualKeyboardDevice device(wf::get_text_keys(),
+                wf::osk::get_repeat_config());
 
-            return *instance;
+            missing = device.type_text(wf::osk::utf8_to_utf32(text));
+            if (show_stats)
+                print_stats(device.get_stats());
         }
 
-        VirtualKeyboardDevice& Keyboard::get_device()
-        {
-            return *vk;
-        }
+        /* The device only flushes without waiting, the compositor must
+         * have all the requests, up to its destruction, before we exit */
+        wl_display_roundtrip(wf::WaylandDisplay::get().display);
+    } else if (show_stats)
+    {
+        std::cout << "typed by the running keyboard, see its statistics" << std::endl;
+    }
 
-        Gtk::Window& Keyboard::get_window()
-        {
-            return *window;
-        }
+    if (missing)
+        std::cerr << "Could not type " << missing << " characters" << std::endl;
 
-        void Keyboard::handle_action(uint32_t action)
-        {
-            if (action == ABC_TOGGLE)
-            {
-                if (current_layout == default_layout.get()) {
-                    set_layout(shift_layout.get());
-                } else {
-                    set_layout(default_layout.get());
-                }
-            }
-
-            if (action == NUM_TOGGLE)
-                set_layout(numeric_layout.get());
-        }
-    }
+    return missing ? 1 : 0;
 }
 
 int main(int argc, char **argv)
 {
     bool show_help = false;
+    bool show_stats = false;
+    std::string type_text;
 
     auto cli = clara::detail::Help(show_help) |
         clara::detail::Opt(wf::osk::default_width, "int")["-w"]["--width"]
@@ -184,7 +100,36 @@ int main(int argc, char **argv)
         clara::detail::Opt(wf::osk::headerbar_size, "int")["-b"]["--headerbar-height"]
             ("headerbar height") |
         clara::detail::Opt(wf::osk::anchor, "top|left|bottom|right|pinned")["-a"]
-            ["--anchor"]("where the keyboard should anchor in the screen");
+            ["--anchor"]("where the keyboard should anchor in the screen") |
+        clara::detail::Opt(wf::osk::repeat_delay, "ms")["--repeat-delay"]
+            ("time a key is held before it starts repeating") |
+        clara::detail::Opt(wf::osk::repeat_rate, "int")["--repeat-rate"]
+            ("key repeats per second, 0 disables key repeat") |
+        clara::detail::Opt(wf::osk::repeat_acceleration, "factor")["--repeat-acceleration"]
+            ("repeat interval multiplier for backspace and arrow keys") |
+        clara::detail::Opt(wf::osk::use_canvas)["-c"]["--canvas"]
+            ("draw the keyboard as a single widget instead of one button per key") |
+        clara::detail::Opt(wf::osk::dictionary_path, "file")["--dictionary"]
+            ("word list for swipe typing on the canvas, one word per line, "
+             "most frequent first") |
+        clara::detail::Opt(wf::osk::completion_path, "file")["--completion"]
+            ("show completions from a trie built with wf-osk-dict") |
+        clara::detail::Opt(wf::osk::prediction_path, "file")["--prediction"]
+            ("show next-word predictions from a model built with wf-osk-dict") |
+        clara::detail::Opt(wf::osk::correction_path, "file")["--autocorrect"]
+            ("correct words from an index built with wf-osk-dict when they are ended "
+             "with a space or punctuation") |
+        clara::detail::Opt(wf::osk::learn_words)["--learn"]
+            ("learn the typed words and complete them, they are kept in "
+             "$XDG_DATA_HOME/wf-osk") |
+        clara::detail::Opt(wf::osk::layout_path, "file")["--layout"]
+            ("load the layouts from a text file instead of the built-in ones, "
+             "see layouts/default.layout") |
+        clara::detail::Opt(show_stats)["-s"]["--stats"]
+            ("print virtual keyboard request and repaint statistics on exit") |
+        clara::detail::Opt(type_text, "text")["-t"]["--type"]
+            ("type the text and exit, with the running keyboard if there is one, "
+             "otherwise without showing the keyboard");
 
     auto res = cli.parse(clara::detail::Args(argc, argv));
     if (!res) {
@@ -197,7 +142,32 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    /* Needs only a wayland connection, not GTK */
+    if (!type_text.empty())
+        return run_type_text(type_text, show_stats);
+
     auto app = Gtk::Application::create();
     wf::osk::Keyboard::create();
-    return app->run(wf::osk::Keyboard::get().get_window());
+    wf::latency::install_signal_handler();
+    int ret = app->run(wf::osk::Keyboard::get().get_window());
+
+    if (show_stats)
+    {
+        auto& keyboard = wf::osk::Keyboard::get();
+        print_stats(keyboard.get_device().get_stats());
+        if (auto canvas = keyboard.get_canvas())
+            print_render_stats(canvas->get_stats());
+
+        if (auto user_dictionary = keyboard.get_user_dictionary())
+            print_learning_stats(user_dictionary->get_stats());
+    }
+
+    wf::latency::dump(std::cerr);
+    if (const char *json_path = getenv("WF_OSK_LATENCY_JSON"))
+    {
+        std::ofstream json(json_path);
+        wf::latency::dump_json(json);
+    }
+
+    return ret;
 }
@@ -1,26 +1,49 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <set>
+#include <map>
+#include <tuple>
 #include <memory>
 
 #include <gtkmm.h>
 
 #include "virtual-keyboard.hpp"
 #include "wayland-window.hpp"
+#include "layout.hpp"
+#include "layout-file.hpp"
+#include "key-geometry.hpp"
+#include "swipe.hpp"
+#include "completion.hpp"
+#include "prediction.hpp"
+#include "correction.hpp"
+#include "user-dictionary.hpp"
+#include "text-server.hpp"
+#include "latency.hpp"
 
 namespace wf
 {
     namespace osk
     {
+        /* Settings from the command line */
         extern int spacing;
+        extern int default_width, default_height, headerbar_size;
+        extern int repeat_delay, repeat_rate;
+        extern double repeat_acceleration;
+        extern bool use_canvas, learn_words;
+        extern std::string dictionary_path, completion_path, prediction_path,
+            correction_path, layout_path;
+        extern std::string anchor;
 
-        struct Key
-        {
-            uint32_t code;
-            Glib::ustring text;
-            double width;
-        };
+        /* Key repeat settings from the command line */
+        repeat_config_t get_repeat_config();
+
+        /* The layout tables of layouts.tpp */
+        const LayoutTable& get_builtin_layout(layout_id_t id);
+
+        std::u32string utf8_to_utf32(const std::string& text);
 
         struct KeyButton
         {
@@ -28,7 +51,14 @@ namespace wf
 
             /* keycode as in linux/input-event-codes.h */
             uint32_t code;
+            /* code at the time the key was pressed */
+            uint32_t pressed_code = 0;
             KeyButton(Key key, int width, int height);
+            /* Change the code and label, keeping the size */
+            void set_key(const Key& key);
+            /* Show a modifier key as checked while its modifier is latched
+             * or locked, with the latched or locked style class */
+            void show_modifiers(uint32_t latched, uint32_t locked);
 
             private:
             void on_pressed();
@@ -40,7 +70,7 @@ namespace wf
             Gtk::HBox box;
             std::vector<std::unique_ptr<KeyButton>> keys;
 
-            KeyboardRow(std::vector<Key> keys,
+            KeyboardRow(const KeyRowTable& keys,
                 int width, int height);
         };
 
@@ -49,20 +79,203 @@ namespace wf
             Gtk::VBox box;
             std::vector<std::unique_ptr<KeyboardRow>> rows;
 
-            KeyboardLayout(std::vector<std::vector<Key>> keys,
+            KeyboardLayout(const LayoutTable& keys,
+                int32_t width, int32_t height);
+
+            /* Relabel the keys in place, keys must have the same shape as
+             * the table the layout was built from */
+            void set_keys(const LayoutTable& keys);
+            void show_modifiers(uint32_t latched, uint32_t locked);
+        };
+
+        /* Counters of the canvas repaints, for --stats */
+        struct render_stats_t
+        {
+            uint64_t key_events = 0;
+            uint64_t draws = 0;
+            /* area of all clip rectangles drawn */
+            uint64_t repainted_pixels = 0;
+            uint64_t surface_pixels = 0;
+            /* area of the keys invalidated, the canvas draws no more */
+            uint64_t damaged_pixels = 0;
+            /* most keys held at the same time */
+            uint64_t max_presses = 0;
+            /* lookups in the key sprite cache, and its size in bytes */
+            uint64_t sprite_hits = 0;
+            uint64_t sprite_misses = 0;
+            uint64_t sprite_bytes = 0;
+        };
+
+        /* Draws a whole layout with cairo and handles its input, instead
+         * of using one Gtk::Button per key */
+        class KeyboardCanvas : public Gtk::DrawingArea
+        {
+            /* The keys of all rows, and their geometry, in row order */
+            std::vector<Key> keys;
+            KeyGeometry geometry;
+            std::vector<size_t> row_sizes;
+
+            /* A key held by a touch, or by the pointer */
+            struct press_t
+            {
+                /* index in keys, -1 after a layout switch */
+                int key;
+                /* code at the time the key was pressed */
+                uint32_t code;
+                /* turned into a swipe, the key is already released */
+                bool swiped = false;
+            };
+
+            /* Every touch sequence presses its own key, nullptr is the
+             * pointer */
+            std::map<GdkEventSequence*, press_t> presses;
+            /* Number of presses holding each key, for drawing */
+            std::vector<int> pressed_count;
+            render_stats_t stats;
+            /* Modifiers tapped by the user, their keys are drawn pressed,
+             * and underlined once locked */
+            uint32_t latched_modifiers = 0, locked_modifiers = 0;
+
+            enum key_look_t
+            {
+                KEY_NORMAL,
+                KEY_PRESSED,
+                KEY_LOCKED,
+            };
+
+            key_look_t get_key_look(size_t i) const;
+
+            /* Keys rasterized with their label, by label, size and look,
+             * so that keys of other layouts can share them. Only valid for
+             * one scale and theme color. */
+            using sprite_key_t = std::tuple<std::string_view, int, int, key_look_t>;
+            std::map<sprite_key_t, Cairo::RefPtr<Cairo::ImageSurface>> sprites;
+            int sprite_scale = 0;
+            Gdk::RGBA sprite_color;
+
+            void update_geometry();
+            /* Invalidate only the area of the given key */
+            void queue_draw_key(int i);
+            /* Draw the key into a surface of its size */
+            void render_key(const Cairo::RefPtr<Cairo::Context>& cr, size_t i,
+                key_look_t look);
+            Cairo::RefPtr<Cairo::ImageSurface> get_sprite(size_t i, key_look_t look);
+            void clear_sprites();
+
+            /* Swipe typing, a press on a letter turns into a swipe when it
+             * leaves its key, as long as it is the only press */
+            bool swipe_enabled = false;
+            bool swipe_tracking = false, swiping = false;
+            GdkEventSequence *swipe_sequence = nullptr;
+            int swipe_key = -1;
+            std::vector<swipe_point_t> trail;
+            /* Bounding box of the trail */
+            double trail_x1, trail_y1, trail_x2, trail_y2;
+            swipe_request_t make_swipe_request() const;
+            void queue_draw_trail(double x1, double y1, double x2, double y2);
+
+            void begin_press(GdkEventSequence *sequence, double x, double y);
+            void update_press(GdkEventSequence *sequence, double x, double y);
+            void end_press(GdkEventSequence *sequence);
+
+            protected:
+            bool on_draw(const Cairo::RefPtr<Cairo::Context>& cr) override;
+            void on_size_allocate(Gtk::Allocation& allocation) override;
+            void on_style_updated() override;
+            bool on_button_press_event(GdkEventButton *event) override;
+            bool on_button_release_event(GdkEventButton *event) override;
+            bool on_motion_notify_event(GdkEventMotion *event) override;
+            bool on_touch_event(GdkEventTouch *event) override;
+
+            public:
+            KeyboardCanvas(const LayoutTable& keys,
                 int32_t width, int32_t height);
+
+            /* Switch to another layout, keys may have any shape */
+            void set_keys(const LayoutTable& keys);
+            const render_stats_t& get_stats() const;
+            void show_modifiers(uint32_t latched, uint32_t locked);
+            /* Send swipes to Keyboard::decode_swipe() */
+            void set_swipe_enabled(bool enabled);
+        };
+
+        /* Buttons with completions of the word being typed, or with
+         * predictions of the next word */
+        struct SuggestionBar
+        {
+            static constexpr int SUGGESTIONS = 3;
+
+            Gtk::HBox box;
+            Gtk::Button buttons[SUGGESTIONS];
+            std::vector<std::string> words;
+
+            SuggestionBar(int height);
+            void set_words(std::vector<std::string> words);
         };
 
         class Keyboard
         {
-            std::unique_ptr<KeyboardLayout> default_layout, shift_layout,
-                numeric_layout;
+            /* The built-in layouts, or those of a layout file */
+            std::unique_ptr<LayoutFile> layout_file;
+            LayoutTable layouts[LAYOUT_COUNT];
+            /* The shift layout only differs from the default one in its
+             * labels and codes, so they share the same widgets */
+            std::unique_ptr<KeyboardLayout> default_layout, numeric_layout;
             KeyboardLayout *current_layout = nullptr;
+            /* Replaces the layouts above when drawing into a single widget */
+            std::unique_ptr<KeyboardCanvas> canvas;
+            const LayoutTable *current_keys = nullptr;
+            /* evdev keycodes used by the layouts */
+            std::set<uint32_t> used_keycodes;
+            /* Number of presses holding each evdev code, with multi-touch
+             * a key can be pressed again before it is released */
+            std::map<uint32_t, int> held_keys;
             void init_layouts();
+            KeyboardLayout *get_layout(std::unique_ptr<KeyboardLayout>& layout,
+                const LayoutTable& keys);
             void set_layout(KeyboardLayout *new_layout);
+            void show_keys(const LayoutTable& keys);
+            /* Show the latched and locked modifiers on the keys shown */
+            void show_modifiers();
 
             std::unique_ptr<WaylandWindow> window;
             std::unique_ptr<VirtualKeyboardDevice> vk;
+            /* Only with a canvas and a dictionary */
+            std::unique_ptr<SwipeDecoder> swipe_decoder;
+            void on_swipe_decoded(std::string word);
+
+            /* Only with a completion trie or a prediction model */
+            std::unique_ptr<CompletionTrie> completion;
+            std::unique_ptr<NgramModel> prediction;
+            std::unique_ptr<SuggestionBar> suggestion_bar;
+            /* Only with a correction index */
+            std::unique_ptr<CorrectionIndex> correction;
+            /* Only when learning words, the trie is loaded after each
+             * compaction */
+            std::unique_ptr<UserDictionary> user_dictionary;
+            std::unique_ptr<CompletionTrie> learned_words;
+            void load_learned_words();
+            /* Types the text of wf-osk --type with vk */
+            std::unique_ptr<TextServer> text_server;
+            /* The word being typed, lowercase, and the trie nodes of its
+             * prefixes, starting with the root, NONE once it is not in
+             * the trie */
+            std::string current_word;
+            std::vector<uint32_t> word_nodes;
+            /* Whether its first letter was typed in uppercase */
+            bool word_capitalized = false;
+            /* Model ids of the two words before it, NONE at the start of
+             * a sentence */
+            uint32_t previous_words[2] = {NgramModel::NONE, NgramModel::NONE};
+            /* Follow the word being typed through a key press */
+            void update_word(uint32_t code);
+            /* Start a new word, keep_context if it continues the sentence */
+            void end_word(bool keep_context);
+            /* Completions of the word, or predictions of the next one */
+            void show_suggestions();
+            /* Replace the word being typed by its correction, if the key
+             * ends it */
+            void autocorrect(uint32_t code);
             Keyboard();
 
             static std::unique_ptr<Keyboard> instance;
@@ -70,10 +283,26 @@ namespace wf
             public:
             static void create();
             static Keyboard& get();
+            /* Destroy the keyboard, so that another one can be created */
+            static void destroy();
 
             void handle_action(uint32_t action);
+            /* Send a key of a layout, code may be a command or modifier key.
+             * The keystroke was started by the press handler, before
+             * Keyboard::get() */
+            void press_key(uint32_t code, latency::keystroke_t& keystroke);
+            void release_key(uint32_t code);
+            /* Type the word the path most likely stands for, except its first
+             * letter, which was typed when the swipe started */
+            void decode_swipe(swipe_request_t request);
+            /* Type the rest of a suggested word, and a space */
+            void accept_suggestion(const std::string& word);
             VirtualKeyboardDevice& get_device();
             Gtk::Window& get_window();
+            /* nullptr unless drawing with a KeyboardCanvas */
+            const KeyboardCanvas *get_canvas() const;
+            /* nullptr unless words are learned */
+            UserDictionary *get_user_dictionary() const;
         };
     }
 }
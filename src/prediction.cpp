@@ -0,0 +1,377 @@
+#include "prediction.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace wf
+{
+    namespace osk
+    {
+        /* Most frequent words kept in the model */
+        static constexpr size_t MAX_VOCABULARY = 100000;
+        /* Most likely words kept after each context */
+        static constexpr size_t MAX_SUCCESSORS = 8;
+        /* Rarer trigrams are dropped */
+        static constexpr uint32_t MIN_TRIGRAM_COUNT = 2;
+        /* Words are counted with 21-bit ids, so that trigrams fit in 64 bits */
+        static constexpr uint32_t MAX_CORPUS_WORDS = 1 << 21;
+
+        NgramModel::NgramModel(const std::string& path)
+        {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if ((fd < 0) || (fstat(fd, &st) < 0))
+            {
+                std::cerr << "Failed to open the prediction model " << path << std::endl;
+                std::exit(-1);
+            }
+
+            size = st.st_size;
+            if (size >= sizeof(ngram_header_t))
+                data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+
+            /* The mapping keeps the file alive */
+            close(fd);
+
+            header = (const ngram_header_t*)data;
+            uint64_t expected = 0;
+            if (header && (data != MAP_FAILED))
+            {
+                expected = sizeof(ngram_header_t) + 4 * (
+                    2 * (uint64_t(header->vocabulary_size) + 1) +
+                    header->bigram_count + 3 * uint64_t(header->trigram_context_count) +
+                    1 + header->trigram_count) + header->text_size;
+            }
+
+            if (!expected || (expected != size) ||
+                std::memcmp(header->magic, NGRAM_MAGIC, sizeof(NGRAM_MAGIC)))
+            {
+                std::cerr << "Invalid prediction model " << path << std::endl;
+                std::exit(-1);
+            }
+
+            word_offsets = (const uint32_t*)(header + 1);
+            bigram_start = word_offsets + header->vocabulary_size + 1;
+            bigrams = bigram_start + header->vocabulary_size + 1;
+            trigram_contexts = bigrams + header->bigram_count;
+            trigram_start = trigram_contexts + 2 * header->trigram_context_count;
+            trigrams = trigram_start + header->trigram_context_count + 1;
+            text = (const char*)(trigrams + header->trigram_count);
+        }
+
+        NgramModel::~NgramModel()
+        {
+            munmap((void*)data, size);
+        }
+
+        const ngram_header_t& NgramModel::get_header() const
+        {
+            return *header;
+        }
+
+        std::string_view NgramModel::get_word(uint32_t id) const
+        {
+            if (id >= header->vocabulary_size)
+                return {};
+
+            /* Offsets are clamped, the file is not checked when mapped */
+            uint32_t start = std::min(word_offsets[id], header->text_size);
+            uint32_t end = std::clamp(word_offsets[id + 1], start, header->text_size);
+            return std::string_view(text + start, end - start);
+        }
+
+        uint32_t NgramModel::find(std::string_view word) const
+        {
+            uint32_t low = 0, high = header->vocabulary_size;
+            while (low < high)
+            {
+                uint32_t mid = low + (high - low) / 2;
+                if (get_word(mid) < word)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+
+            return ((low < header->vocabulary_size) && (get_word(low) == word)) ?
+                low : NONE;
+        }
+
+        size_t NgramModel::add_entries(const uint32_t *entries, uint32_t first,
+            uint32_t last, uint32_t entry_count,
+            prediction_t *out, size_t found, size_t max) const
+        {
+            last = std::min(last, entry_count);
+            for (uint32_t i = first; (i < last) && (found < max); i++)
+            {
+                auto word = get_word(entries[i] >> 8);
+                if (word.empty())
+                    continue;
+
+                /* Words point into the model, so they are the same only if
+                 * they are at the same place */
+                bool seen = false;
+                for (size_t j = 0; j < found; j++)
+                    seen |= (out[j].word.data() == word.data());
+
+                if (!seen)
+                    out[found++] = {word, uint8_t(entries[i] & 0xff)};
+            }
+
+            return found;
+        }
+
+        size_t NgramModel::predict(uint32_t prev2, uint32_t prev1,
+            prediction_t *out, size_t count) const
+        {
+            size_t found = 0;
+            if ((prev2 != NONE) && (prev1 != NONE))
+            {
+                uint32_t low = 0, high = header->trigram_context_count;
+                while (low < high)
+                {
+                    uint32_t mid = low + (high - low) / 2;
+                    auto context = trigram_contexts + 2 * mid;
+                    if ((context[0] < prev2) ||
+                        ((context[0] == prev2) && (context[1] < prev1)))
+                    {
+                        low = mid + 1;
+                    } else
+                    {
+                        high = mid;
+                    }
+                }
+
+                auto context = trigram_contexts + 2 * low;
+                if ((low < header->trigram_context_count) &&
+                    (context[0] == prev2) && (context[1] == prev1))
+                {
+                    found = add_entries(trigrams, trigram_start[low],
+                        trigram_start[low + 1], header->trigram_count,
+                        out, found, count);
+                }
+            }
+
+            if ((prev1 != NONE) && (prev1 < header->vocabulary_size))
+            {
+                found = add_entries(bigrams, bigram_start[prev1],
+                    bigram_start[prev1 + 1], header->bigram_count,
+                    out, found, count);
+            }
+
+            return found;
+        }
+
+        /* -log2(p) in 1/8 bits */
+        static uint8_t quantize_cost(double count, double total)
+        {
+            double cost = -std::log2(count / total) * 8;
+            return std::clamp<double>(std::round(cost), 0, 255);
+        }
+
+        /* Keep the most frequent successors of every context, as entries
+         * sorted by cost */
+        template<class Key>
+        static void pick_successors(
+            const std::unordered_map<Key, std::vector<std::pair<uint32_t, uint32_t>>>& successors,
+            const std::unordered_map<Key, uint32_t>& totals,
+            std::vector<std::pair<Key, std::vector<uint32_t>>>& out)
+        {
+            for (auto& [context, words] : successors)
+            {
+                auto sorted = words;
+                std::sort(sorted.begin(), sorted.end(),
+                    [] (auto& a, auto& b) { return a.second > b.second; });
+                sorted.resize(std::min(sorted.size(), MAX_SUCCESSORS));
+
+                std::vector<uint32_t> entries;
+                for (auto& [word, count] : sorted)
+                    entries.push_back((word << 8) | quantize_cost(count, totals.at(context)));
+
+                out.emplace_back(context, std::move(entries));
+            }
+
+            std::sort(out.begin(), out.end(),
+                [] (auto& a, auto& b) { return a.first < b.first; });
+        }
+
+        bool NgramModel::build(std::istream& corpus, const std::string& path)
+        {
+            /* Corpus words get ids in order of appearance */
+            std::unordered_map<std::string, uint32_t> corpus_ids;
+            std::vector<std::string> corpus_words;
+            std::vector<uint32_t> unigrams;
+            std::unordered_map<uint64_t, uint32_t> bigram_counts;
+            std::unordered_map<uint64_t, uint32_t> trigram_counts;
+
+            /* Punctuation other than apostrophes ends the context */
+            uint32_t prev2 = NONE, prev1 = NONE;
+            auto add_word = [&] (const std::string& word)
+            {
+                auto it = corpus_ids.find(word);
+                if (it == corpus_ids.end())
+                {
+                    if (corpus_words.size() >= MAX_CORPUS_WORDS)
+                    {
+                        prev2 = prev1 = NONE;
+                        return;
+                    }
+
+                    it = corpus_ids.emplace(word, corpus_words.size()).first;
+                    corpus_words.push_back(word);
+                    unigrams.push_back(0);
+                }
+
+                uint32_t id = it->second;
+                unigrams[id]++;
+                if (prev1 != NONE)
+                    bigram_counts[(uint64_t(prev1) << 21) | id]++;
+
+                if ((prev2 != NONE) && (prev1 != NONE))
+                {
+                    trigram_counts[(uint64_t(prev2) << 42) |
+                        (uint64_t(prev1) << 21) | id]++;
+                }
+
+                prev2 = prev1;
+                prev1 = id;
+            };
+
+            std::string line, word;
+            while (std::getline(corpus, line))
+            {
+                for (char c : line + ' ')
+                {
+                    if (std::isalpha((unsigned char)c) || ((c == '\'') && !word.empty()))
+                    {
+                        word += std::tolower((unsigned char)c);
+                        continue;
+                    }
+
+                    if (!word.empty())
+                        add_word(word);
+
+                    word.clear();
+                    if (!std::isspace((unsigned char)c))
+                        prev2 = prev1 = NONE;
+                }
+            }
+
+            /* The vocabulary is the most frequent words, sorted */
+            std::vector<uint32_t> by_count(corpus_words.size());
+            for (uint32_t i = 0; i < by_count.size(); i++)
+                by_count[i] = i;
+
+            std::stable_sort(by_count.begin(), by_count.end(),
+                [&] (uint32_t a, uint32_t b) { return unigrams[a] > unigrams[b]; });
+            by_count.resize(std::min(by_count.size(), MAX_VOCABULARY));
+            std::sort(by_count.begin(), by_count.end(),
+                [&] (uint32_t a, uint32_t b) { return corpus_words[a] < corpus_words[b]; });
+
+            std::vector<uint32_t> model_id(corpus_words.size(), NONE);
+            for (uint32_t i = 0; i < by_count.size(); i++)
+                model_id[by_count[i]] = i;
+
+            const uint64_t mask = MAX_CORPUS_WORDS - 1;
+            using pair_t = std::pair<uint32_t, uint32_t>;
+            std::unordered_map<uint32_t, std::vector<pair_t>> bigram_successors;
+            std::unordered_map<uint32_t, uint32_t> bigram_totals;
+            for (auto& [key, count] : bigram_counts)
+            {
+                uint32_t first = key >> 21, second = key & mask;
+                if ((model_id[first] == NONE) || (model_id[second] == NONE))
+                    continue;
+
+                bigram_successors[model_id[first]].push_back({model_id[second], count});
+                bigram_totals[model_id[first]] = unigrams[first];
+            }
+
+            std::unordered_map<uint64_t, std::vector<pair_t>> trigram_successors;
+            std::unordered_map<uint64_t, uint32_t> trigram_totals;
+            for (auto& [key, count] : trigram_counts)
+            {
+                uint32_t first = key >> 42, second = (key >> 21) & mask;
+                uint32_t third = key & mask;
+                if ((count < MIN_TRIGRAM_COUNT) || (model_id[first] == NONE) ||
+                    (model_id[second] == NONE) || (model_id[third] == NONE))
+                {
+                    continue;
+                }
+
+                uint64_t context = (uint64_t(model_id[first]) << 32) | model_id[second];
+                trigram_successors[context].push_back({model_id[third], count});
+                trigram_totals[context] = bigram_counts[(uint64_t(first) << 21) | second];
+            }
+
+            std::vector<std::pair<uint32_t, std::vector<uint32_t>>> bigram_entries;
+            std::vector<std::pair<uint64_t, std::vector<uint32_t>>> trigram_entries;
+            pick_successors(bigram_successors, bigram_totals, bigram_entries);
+            pick_successors(trigram_successors, trigram_totals, trigram_entries);
+
+            /* Lay out the sections, see ngram_header_t */
+            std::vector<uint32_t> word_offsets = {0}, bigram_start, bigrams;
+            std::vector<uint32_t> trigram_contexts, trigram_start, trigrams;
+            std::string text;
+            for (uint32_t id : by_count)
+            {
+                text += corpus_words[id];
+                word_offsets.push_back(text.size());
+            }
+
+            size_t next = 0;
+            for (uint32_t id = 0; id <= by_count.size(); id++)
+            {
+                bigram_start.push_back(bigrams.size());
+                if ((next < bigram_entries.size()) && (bigram_entries[next].first == id))
+                {
+                    auto& entries = bigram_entries[next++].second;
+                    bigrams.insert(bigrams.end(), entries.begin(), entries.end());
+                }
+            }
+
+            for (auto& [context, entries] : trigram_entries)
+            {
+                trigram_contexts.push_back(context >> 32);
+                trigram_contexts.push_back(context & 0xffffffff);
+                trigram_start.push_back(trigrams.size());
+                trigrams.insert(trigrams.end(), entries.begin(), entries.end());
+            }
+
+            trigram_start.push_back(trigrams.size());
+
+            ngram_header_t header;
+            std::memcpy(header.magic, NGRAM_MAGIC, sizeof(NGRAM_MAGIC));
+            header.vocabulary_size = by_count.size();
+            header.text_size = text.size();
+            header.bigram_count = bigrams.size();
+            header.trigram_context_count = trigram_entries.size();
+            header.trigram_count = trigrams.size();
+            header.reserved = 0;
+
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            auto write = [&] (const std::vector<uint32_t>& section)
+            {
+                file.write((const char*)section.data(), section.size() * 4);
+            };
+
+            file.write((const char*)&header, sizeof(header));
+            write(word_offsets);
+            write(bigram_start);
+            write(bigrams);
+            write(trigram_contexts);
+            write(trigram_start);
+            write(trigrams);
+            file.write(text.data(), text.size());
+            return bool(file);
+        }
+    }
+}
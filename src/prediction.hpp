@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+
+namespace wf
+{
+    namespace osk
+    {
+        /**
+         * Header of a next-word model file, followed by, in this order:
+         *
+         *   uint32_t word_offsets[vocabulary_size + 1]   into text
+         *   uint32_t bigram_start[vocabulary_size + 1]   into bigrams
+         *   uint32_t bigrams[bigram_count]
+         *   uint32_t trigram_contexts[2 * trigram_context_count]
+         *   uint32_t trigram_start[trigram_context_count + 1]
+         *   uint32_t trigrams[trigram_count]
+         *   char text[text_size]
+         *
+         * Words are sorted bytewise, their ids are their indices. Trigram
+         * contexts are sorted (previous word, last word) pairs. An n-gram
+         * entry is (word << 8 | cost), where cost is -log2 of the
+         * probability of the word after the context in 1/8 bits, clamped
+         * to 255. The entries of a context are sorted by cost.
+         */
+        struct ngram_header_t
+        {
+            char magic[8];
+            uint32_t vocabulary_size;
+            uint32_t text_size;
+            uint32_t bigram_count;
+            uint32_t trigram_context_count;
+            uint32_t trigram_count;
+            uint32_t reserved;
+        };
+
+        static constexpr char NGRAM_MAGIC[8] = {'W', 'F', 'O', 'S', 'K', 'N', 'G', '1'};
+
+        struct prediction_t
+        {
+            /* Points into the model */
+            std::string_view word;
+            /* See ngram_header_t */
+            uint8_t cost;
+        };
+
+        /**
+         * A quantized bigram and trigram model, used in place through
+         * mmap() like CompletionTrie. Queries do not allocate.
+         */
+        class NgramModel
+        {
+            const void *data = nullptr;
+            size_t size = 0;
+            const ngram_header_t *header = nullptr;
+            const uint32_t *word_offsets, *bigram_start, *bigrams;
+            const uint32_t *trigram_contexts, *trigram_start, *trigrams;
+            const char *text;
+
+            /* Add entries[first..last) to out, skipping words already in
+             * it, returns the new number of words in out */
+            size_t add_entries(const uint32_t *entries, uint32_t first,
+                uint32_t last, uint32_t entry_count,
+                prediction_t *out, size_t found, size_t max) const;
+
+            public:
+            static constexpr uint32_t NONE = UINT32_MAX;
+
+            /* Map the file, exits if it is not a valid model file */
+            NgramModel(const std::string& path);
+            ~NgramModel();
+            NgramModel(const NgramModel&) = delete;
+            NgramModel& operator = (const NgramModel&) = delete;
+
+            const ngram_header_t& get_header() const;
+            /* Id of the word, NONE if it is not in the vocabulary */
+            uint32_t find(std::string_view word) const;
+            std::string_view get_word(uint32_t id) const;
+
+            /**
+             * Fill out with up to count words most likely to follow the
+             * previous two words, either may be NONE. Trigram predictions
+             * come first, then bigram ones. Returns the number of words.
+             */
+            size_t predict(uint32_t prev2, uint32_t prev1,
+                prediction_t *out, size_t count) const;
+
+            /**
+             * Count the words of a text, read line by line, and write a
+             * model of the most frequent words and the most likely words
+             * after each of them and after each pair of them.
+             */
+            static bool build(std::istream& corpus, const std::string& path);
+        };
+    }
+}
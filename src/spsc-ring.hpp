@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace wf
+{
+    /**
+     * A bounded lock-free queue for exactly one producer thread and one
+     * consumer thread. Capacity must be a power of two.
+     */
+    template<class T, size_t Capacity>
+    class spsc_ring_t
+    {
+        static_assert((Capacity & (Capacity - 1)) == 0,
+            "spsc_ring_t capacity must be a power of two");
+
+        T items[Capacity];
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+
+        public:
+        /* Producer side. Returns false if the ring is full. */
+        bool push(const T& item)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == Capacity)
+                return false;
+
+            items[t & (Capacity - 1)] = item;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        /* Consumer side. Returns false if the ring is empty. */
+        bool pop(T& item)
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire))
+                return false;
+
+            item = items[h & (Capacity - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+    };
+}
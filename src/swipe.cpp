@@ -0,0 +1,281 @@
+#include "swipe.hpp"
+#include "word-list.hpp"
+#include "latency.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+
+namespace wf
+{
+    namespace osk
+    {
+        /* Points both the path and the words are resampled to */
+        static constexpr int SAMPLES = 32;
+        /* Longer words are not considered */
+        static constexpr size_t MAX_WORD_LENGTH = 32;
+        /* Score penalty, in key widths, per e-fold of frequency */
+        static constexpr double FREQUENCY_WEIGHT = 0.05;
+        /* How far from the end of the path the last letter may be */
+        static constexpr double LAST_KEY_RADIUS = 1.5;
+
+        SwipeDictionary::SwipeDictionary(const std::string& path)
+        {
+            struct entry_t
+            {
+                int group;
+                std::string word;
+                float weight;
+            };
+
+            /* Without counts, words are weighted by their rank */
+            auto list = read_word_list(path);
+            std::vector<entry_t> entries;
+            for (size_t rank = 0; rank < list.size(); rank++)
+            {
+                std::string word = list[rank].word;
+                std::transform(word.begin(), word.end(), word.begin(),
+                    [] (unsigned char c) { return std::tolower(c); });
+
+                if ((word.size() < 2) || (word.size() > MAX_WORD_LENGTH) ||
+                    !std::all_of(word.begin(), word.end(),
+                        [] (char c) { return (c >= 'a') && (c <= 'z'); }))
+                {
+                    continue;
+                }
+
+                float weight = (list[rank].count > 0) ?
+                    std::log(list[rank].count) : -std::log(rank + 1.0);
+                entries.push_back({(word.front() - 'a') * 26 + (word.back() - 'a'),
+                    word, weight});
+            }
+
+            std::stable_sort(entries.begin(), entries.end(),
+                [] (const entry_t& a, const entry_t& b)
+            {
+                return a.group < b.group;
+            });
+
+            for (auto& entry : entries)
+            {
+                group_start[entry.group + 1]++;
+                words.push_back(chars.size());
+                weights.push_back(entry.weight);
+                chars += entry.word;
+                chars += '\0';
+            }
+
+            for (size_t i = 1; i < group_start.size(); i++)
+                group_start[i] += group_start[i - 1];
+        }
+
+        size_t SwipeDictionary::size() const
+        {
+            return words.size();
+        }
+
+        static double distance(const swipe_point_t& a, const swipe_point_t& b)
+        {
+            return std::hypot(a.x - b.x, a.y - b.y);
+        }
+
+        static double path_length(const swipe_point_t *points, size_t count)
+        {
+            double length = 0;
+            for (size_t i = 1; i < count; i++)
+                length += distance(points[i - 1], points[i]);
+
+            return length;
+        }
+
+        /* Resample to SAMPLES points equally spaced along the path */
+        static void resample(const swipe_point_t *points, size_t count,
+            double length, swipe_point_t *out)
+        {
+            if ((count < 2) || (length <= 0))
+            {
+                std::fill(out, out + SAMPLES, points[0]);
+                return;
+            }
+
+            double step = length / (SAMPLES - 1);
+            size_t segment = 1;
+            double segment_start = 0;
+            for (int i = 0; i < SAMPLES; i++)
+            {
+                double target = i * step;
+                while ((segment < count - 1) && (segment_start +
+                    distance(points[segment - 1], points[segment]) < target))
+                {
+                    segment_start += distance(points[segment - 1], points[segment]);
+                    segment++;
+                }
+
+                auto& a = points[segment - 1];
+                auto& b = points[segment];
+                double len = distance(a, b);
+                double t = (len > 0) ? std::clamp((target - segment_start) / len,
+                    0.0, 1.0) : 0;
+                out[i] = {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+            }
+        }
+
+        std::string SwipeDecoder::decode_path(const SwipeDictionary& dictionary,
+            const swipe_request_t& request)
+        {
+            auto& path = request.path;
+            if (path.empty() || (request.first < 'a') || (request.first > 'z'))
+                return "";
+
+            double key_width = std::max(request.key_width, 1.0);
+            double length = path_length(path.data(), path.size());
+            swipe_point_t traced[SAMPLES];
+            resample(path.data(), path.size(), length, traced);
+
+            std::string best;
+            double best_score = std::numeric_limits<double>::infinity();
+            float max_weight = -std::numeric_limits<float>::infinity();
+
+            /* Candidate words start with the first letter and end on a key
+             * near the end of the path. They are scored by the mean distance
+             * between the traced path and the path through their keys, plus
+             * a penalty for being less frequent than the most frequent
+             * candidate. */
+            for (char last = 'a'; last <= 'z'; last++)
+            {
+                auto& center = request.centers[last - 'a'];
+                if ((center.x < 0) ||
+                    (distance(center, path.back()) > LAST_KEY_RADIUS * key_width))
+                {
+                    continue;
+                }
+
+                dictionary.for_each(request.first, last,
+                    [&] (const char *, float weight)
+                {
+                    max_weight = std::max(max_weight, weight);
+                });
+            }
+
+            swipe_point_t letters[MAX_WORD_LENGTH];
+            swipe_point_t ideal[SAMPLES];
+            for (char last = 'a'; last <= 'z'; last++)
+            {
+                auto& center = request.centers[last - 'a'];
+                if ((center.x < 0) ||
+                    (distance(center, path.back()) > LAST_KEY_RADIUS * key_width))
+                {
+                    continue;
+                }
+
+                dictionary.for_each(request.first, last,
+                    [&] (const char *word, float weight)
+                {
+                    double penalty = FREQUENCY_WEIGHT * (max_weight - weight);
+                    if (penalty >= best_score)
+                        return;
+
+                    /* Repeated letters do not change the path */
+                    size_t count = 0;
+                    for (const char *c = word; *c; c++)
+                    {
+                        auto& key = request.centers[*c - 'a'];
+                        if (key.x < 0)
+                            return;
+
+                        if ((count == 0) || (*c != c[-1]))
+                            letters[count++] = key;
+                    }
+
+                    double ideal_length = path_length(letters, count);
+                    if (std::abs(ideal_length - length) > 0.5 * length + 2 * key_width)
+                        return;
+
+                    resample(letters, count, ideal_length, ideal);
+
+                    /* Stop as soon as the word cannot beat the best one */
+                    double limit = (best_score - penalty) * key_width * SAMPLES;
+                    double sum = 0;
+                    for (int i = 0; (i < SAMPLES) && (sum < limit); i++)
+                        sum += distance(traced[i], ideal[i]);
+
+                    double score = sum / (key_width * SAMPLES) + penalty;
+                    if (score < best_score)
+                    {
+                        best_score = score;
+                        best = word;
+                    }
+                });
+            }
+
+            return best;
+        }
+
+        SwipeDecoder::SwipeDecoder(const std::string& dictionary_path,
+            std::function<void(std::string)> on_decoded)
+            : dictionary(dictionary_path), on_decoded(on_decoded)
+        {
+            dispatcher.connect(sigc::mem_fun(this, &SwipeDecoder::deliver_results));
+            worker = std::thread([=] () { run(); });
+        }
+
+        SwipeDecoder::~SwipeDecoder()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+
+            wakeup.notify_one();
+            worker.join();
+        }
+
+        void SwipeDecoder::decode(swipe_request_t request)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                requests.push_back(std::move(request));
+            }
+
+            wakeup.notify_one();
+        }
+
+        void SwipeDecoder::run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                wakeup.wait(lock, [=] { return stopping || !requests.empty(); });
+                if (stopping)
+                    return;
+
+                auto request = std::move(requests.front());
+                requests.pop_front();
+                lock.unlock();
+
+                std::string word;
+                {
+                    latency::scope_t timer(latency::STAGE_SWIPE_DECODE);
+                    word = decode_path(dictionary, request);
+                }
+
+                lock.lock();
+                results.push_back(std::move(word));
+                dispatcher.emit();
+            }
+        }
+
+        void SwipeDecoder::deliver_results()
+        {
+            std::deque<std::string> ready;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready.swap(results);
+            }
+
+            for (auto& word : ready)
+                on_decoded(word);
+        }
+    }
+}
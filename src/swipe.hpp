@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glibmm/dispatcher.h>
+
+namespace wf
+{
+    namespace osk
+    {
+        struct swipe_point_t
+        {
+            double x, y;
+        };
+
+        /* A traced path and the keyboard it was traced on */
+        struct swipe_request_t
+        {
+            std::vector<swipe_point_t> path;
+            /* Centers of the keys of the letters a-z, x < 0 if the
+             * layout has no such key */
+            std::array<swipe_point_t, 26> centers;
+            /* Typical letter key width, distances are relative to it */
+            double key_width;
+            /* The letter of the key the path started on */
+            char first;
+        };
+
+        /**
+         * The words of a word list which only use the letters a-z, grouped
+         * by their first and last letter. Within a group, words are from
+         * most to least frequent.
+         */
+        class SwipeDictionary
+        {
+            /* All words, each terminated by a '\0' */
+            std::string chars;
+            /* Offsets in chars of the words of each group */
+            std::vector<uint32_t> words;
+            std::array<uint32_t, 26 * 26 + 1> group_start = {};
+            /* Higher is more frequent, parallel to words */
+            std::vector<float> weights;
+
+            public:
+            /* Read a word list, see read_word_list() */
+            SwipeDictionary(const std::string& path);
+
+            size_t size() const;
+
+            /* Call fn(word, weight) for every word from first to last */
+            template<class F>
+            void for_each(char first, char last, F&& fn) const
+            {
+                int group = (first - 'a') * 26 + (last - 'a');
+                for (uint32_t i = group_start[group];
+                     i < group_start[group + 1]; i++)
+                {
+                    fn(chars.data() + words[i], weights[i]);
+                }
+            }
+        };
+
+        /**
+         * Decodes traced paths into words on a worker thread. Results are
+         * delivered in order on the thread which created the decoder,
+         * through the main loop.
+         */
+        class SwipeDecoder
+        {
+            SwipeDictionary dictionary;
+            std::function<void(std::string)> on_decoded;
+
+            std::mutex mutex;
+            std::condition_variable wakeup;
+            std::deque<swipe_request_t> requests;
+            std::deque<std::string> results;
+            bool stopping = false;
+
+            Glib::Dispatcher dispatcher;
+            std::thread worker;
+
+            void run();
+            void deliver_results();
+
+            public:
+            SwipeDecoder(const std::string& dictionary_path,
+                std::function<void(std::string)> on_decoded);
+            ~SwipeDecoder();
+
+            void decode(swipe_request_t request);
+
+            /* The most likely word for the path, empty if none matches */
+            static std::string decode_path(const SwipeDictionary& dictionary,
+                const swipe_request_t& request);
+        };
+    }
+}
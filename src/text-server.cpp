@@ -0,0 +1,214 @@
+#include "text-server.hpp"
+#include "osk.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <glibmm/main.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+namespace wf
+{
+    namespace osk
+    {
+        /* A client cannot make the keyboard buffer more than this */
+        static constexpr size_t MAX_TEXT_SIZE = 1 << 20;
+        /* A keyboard which takes longer to type the text is considered
+         * hung, the client types the text itself */
+        static constexpr int REPLY_TIMEOUT_SEC = 10;
+
+        static bool get_address(sockaddr_un& address)
+        {
+            auto path = TextServer::get_socket_path();
+            address = {};
+            address.sun_family = AF_UNIX;
+            if (path.empty() || (path.size() >= sizeof(address.sun_path)))
+                return false;
+
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            return true;
+        }
+
+        std::string TextServer::get_socket_path()
+        {
+            const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+            if (!runtime_dir || !*runtime_dir)
+                return "";
+
+            /* WAYLAND_DISPLAY may also be a path */
+            const char *display = getenv("WAYLAND_DISPLAY");
+            std::string name = (display && *display) ? display : "wayland-0";
+            std::replace(name.begin(), name.end(), '/', '-');
+            return std::string(runtime_dir) + "/wf-osk-" + name;
+        }
+
+        TextServer::TextServer(std::function<size_t(const std::string&)> type_text)
+            : type_text(type_text)
+        {
+            sockaddr_un address;
+            if (!get_address(address))
+                return;
+
+            /* The socket of a keyboard which did not exit cleanly is
+             * replaced, the last keyboard started gets the text */
+            unlink(address.sun_path);
+            listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+            if ((listen_fd < 0) ||
+                (bind(listen_fd, (sockaddr*)&address, sizeof(address)) < 0) ||
+                (listen(listen_fd, 4) < 0))
+            {
+                std::cerr << "Failed to listen on " << address.sun_path << ": "
+                    << std::strerror(errno) << std::endl;
+                if (listen_fd >= 0)
+                    close(listen_fd);
+
+                listen_fd = -1;
+                return;
+            }
+
+            path = address.sun_path;
+            accept_watch = Glib::signal_io().connect([=] (Glib::IOCondition)
+            {
+                return on_accept();
+            }, listen_fd, Glib::IO_IN);
+        }
+
+        TextServer::~TextServer()
+        {
+            accept_watch.disconnect();
+            for (auto& [fd, client] : clients)
+            {
+                client.watch.disconnect();
+                close(fd);
+            }
+
+            if (listen_fd >= 0)
+            {
+                close(listen_fd);
+                unlink(path.c_str());
+            }
+        }
+
+        bool TextServer::on_accept()
+        {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (fd < 0)
+                return true;
+
+            clients[fd].watch = Glib::signal_io().connect([=] (Glib::IOCondition)
+            {
+                return on_client_input(fd);
+            }, fd, Glib::IO_IN | Glib::IO_HUP);
+            return true;
+        }
+
+        bool TextServer::on_client_input(int fd)
+        {
+            auto& client = clients[fd];
+            char buffer[4096];
+            ssize_t ret = read(fd, buffer, sizeof(buffer));
+            if ((ret < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+                return true;
+
+            if ((ret > 0) && (client.text.size() + ret <= MAX_TEXT_SIZE))
+            {
+                client.text.append(buffer, ret);
+                return true;
+            }
+
+            /* The text is complete once the client shuts down its side */
+            if (ret == 0)
+            {
+                auto reply = std::to_string(type_text(client.text)) + "\n";
+                /* A few bytes always fit in the socket buffer */
+                send(fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+            } else if (ret > 0)
+            {
+                std::cerr << "Ignoring text of more than " << MAX_TEXT_SIZE
+                    << " bytes" << std::endl;
+            }
+
+            /* Returning false removes the watch */
+            close(fd);
+            clients.erase(fd);
+            return false;
+        }
+
+        bool TextServer::send_text(const std::string& text, size_t& missing)
+        {
+            sockaddr_un address;
+            if (!get_address(address))
+                return false;
+
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if ((fd < 0) || (connect(fd, (sockaddr*)&address, sizeof(address)) < 0))
+            {
+                if (fd >= 0)
+                    close(fd);
+
+                return false;
+            }
+
+            timeval timeout = {REPLY_TIMEOUT_SEC, 0};
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+            bool timed_out = false;
+            size_t written = 0;
+            while (written < text.size())
+            {
+                ssize_t ret = send(fd, text.data() + written, text.size() - written,
+                    MSG_NOSIGNAL);
+                if ((ret < 0) && (errno == EINTR))
+                    continue;
+
+                timed_out = (ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK));
+                if (ret <= 0)
+                    break;
+
+                written += ret;
+            }
+
+            shutdown(fd, SHUT_WR);
+
+            /* The keyboard replies once the text is typed */
+            std::string reply;
+            char buffer[64];
+            while (!timed_out)
+            {
+                ssize_t ret = read(fd, buffer, sizeof(buffer));
+                if ((ret < 0) && (errno == EINTR))
+                    continue;
+
+                timed_out = (ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK));
+                if (ret <= 0)
+                    break;
+
+                reply.append(buffer, ret);
+            }
+
+            close(fd);
+            if (timed_out)
+            {
+                std::cerr << "The running keyboard does not respond" << std::endl;
+                return false;
+            }
+
+            if ((written < text.size()) || reply.empty())
+            {
+                std::cerr << "The running keyboard did not take the text" << std::endl;
+                missing = utf8_to_utf32(text).size();
+            } else
+            {
+                missing = std::strtoull(reply.c_str(), nullptr, 10);
+            }
+
+            return true;
+        }
+    }
+}
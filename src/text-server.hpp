@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <sigc++/connection.h>
+
+namespace wf
+{
+    namespace osk
+    {
+        /**
+         * Lets other processes type text with the virtual keyboard of a
+         * running wf-osk, through a unix socket in XDG_RUNTIME_DIR, so
+         * that scripts do not need a virtual keyboard of their own.
+         *
+         * A client writes UTF-8 text and shuts down its side of the
+         * connection. The text is typed as a single batch once it is
+         * complete, and the client gets back the number of characters
+         * which could not be typed, as a decimal number. See send_text().
+         */
+        class TextServer
+        {
+            std::function<size_t(const std::string&)> type_text;
+            std::string path;
+            int listen_fd = -1;
+            sigc::connection accept_watch;
+
+            struct client_t
+            {
+                std::string text;
+                sigc::connection watch;
+            };
+
+            std::map<int, client_t> clients;
+            bool on_accept();
+            bool on_client_input(int fd);
+
+            public:
+            /* type_text types the text and returns the number of
+             * characters it could not type */
+            TextServer(std::function<size_t(const std::string&)> type_text);
+            ~TextServer();
+
+            /* $XDG_RUNTIME_DIR/wf-osk-$WAYLAND_DISPLAY, empty without
+             * XDG_RUNTIME_DIR */
+            static std::string get_socket_path();
+
+            /**
+             * Type the text with a running keyboard. Returns false if no
+             * keyboard is running or it does not reply in time, otherwise
+             * missing is the number of characters which were not typed.
+             */
+            static bool send_text(const std::string& text, size_t& missing);
+        };
+    }
+}
@@ -0,0 +1,343 @@
+#include "user-dictionary.hpp"
+#include "completion.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace wf
+{
+    namespace osk
+    {
+        /* Fewer appended records are never worth a compaction */
+        static constexpr uint32_t MIN_COMPACTION_RECORDS = 1024;
+
+        static uint32_t fnv1a(const void *data, size_t size,
+            uint32_t hash = 2166136261u)
+        {
+            for (size_t i = 0; i < size; i++)
+                hash = (hash ^ ((const uint8_t*)data)[i]) * 16777619u;
+
+            return hash;
+        }
+
+        static void add_record(std::string& out, const std::string& word,
+            uint32_t count)
+        {
+            learned_record_t record = {0, count, uint16_t(word.size()), 0};
+            record.checksum = fnv1a(word.data(), word.size(),
+                fnv1a(&record, sizeof(record)));
+            out.append((const char*)&record, sizeof(record));
+            out += word;
+        }
+
+        static bool write_all(int fd, const std::string& data)
+        {
+            size_t written = 0;
+            while (written < data.size())
+            {
+                ssize_t ret = write(fd, data.data() + written, data.size() - written);
+                if ((ret < 0) && (errno == EINTR))
+                    continue;
+
+                if (ret <= 0)
+                    return false;
+
+                written += ret;
+            }
+
+            return true;
+        }
+
+        /* Make the file durable under its final name */
+        static bool replace_file(const std::string& from, const std::string& to)
+        {
+            int fd = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+            bool synced = (fd >= 0) && (fsync(fd) == 0);
+            if (fd >= 0)
+                close(fd);
+
+            return synced && (rename(from.c_str(), to.c_str()) == 0);
+        }
+
+        UserDictionary::UserDictionary(const std::string& directory,
+            std::function<void()> on_compacted)
+            : on_compacted(on_compacted)
+        {
+            /* Create the missing parents too */
+            for (size_t slash = directory.find('/', 1); ;
+                 slash = directory.find('/', slash + 1))
+            {
+                mkdir(directory.substr(0, slash).c_str(), 0755);
+                if (slash == std::string::npos)
+                    break;
+            }
+
+            log_path = directory + "/learned-words.log";
+            trie_path = directory + "/learned-words.trie";
+            dispatcher.connect([=] () { this->on_compacted(); });
+            worker = std::thread([=] () { run(); });
+        }
+
+        UserDictionary::~UserDictionary()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+
+            wakeup.notify_one();
+            worker.join();
+        }
+
+        std::string UserDictionary::default_directory()
+        {
+            const char *data_home = getenv("XDG_DATA_HOME");
+            if (data_home && *data_home)
+                return std::string(data_home) + "/wf-osk";
+
+            const char *home = getenv("HOME");
+            return std::string(home ? home : "") + "/.local/share/wf-osk";
+        }
+
+        void UserDictionary::learn(const std::string& word)
+        {
+            if (word.empty() || (word.size() > UINT16_MAX))
+                return;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending.push_back(word);
+            }
+
+            wakeup.notify_one();
+        }
+
+        void UserDictionary::flush()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            written.wait(lock, [=] { return !writing && pending.empty(); });
+        }
+
+        const std::string& UserDictionary::get_trie_path() const
+        {
+            return trie_path;
+        }
+
+        learning_stats_t UserDictionary::get_stats()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return stats;
+        }
+
+        void UserDictionary::replay()
+        {
+            log_fd = open(log_path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            struct stat st;
+            if ((log_fd < 0) || (fstat(log_fd, &st) < 0))
+            {
+                std::cerr << "Failed to open " << log_path
+                    << ", learned words are not saved" << std::endl;
+                return;
+            }
+
+            std::string data(st.st_size, '\0');
+            size_t size = 0;
+            while (size < data.size())
+            {
+                ssize_t ret = pread(log_fd, &data[size], data.size() - size, size);
+                if (ret <= 0)
+                    break;
+
+                size += ret;
+            }
+
+            learned_log_header_t header;
+            if ((size < sizeof(header)) ||
+                std::memcmp(data.data(), LEARNED_LOG_MAGIC, sizeof(LEARNED_LOG_MAGIC)))
+            {
+                if (size)
+                    std::cerr << "Ignoring the invalid log " << log_path << std::endl;
+
+                std::memcpy(header.magic, LEARNED_LOG_MAGIC, sizeof(LEARNED_LOG_MAGIC));
+                header.snapshot_records = header.reserved = 0;
+                if ((ftruncate(log_fd, 0) < 0) ||
+                    !write_all(log_fd, std::string((const char*)&header, sizeof(header))))
+                {
+                    std::cerr << "Failed to write " << log_path << std::endl;
+                }
+
+                return;
+            }
+
+            std::memcpy(&header, data.data(), sizeof(header));
+
+            /* Records are replayed up to the first torn or corrupted one,
+             * which is cut off together with everything after it */
+            size_t offset = sizeof(header);
+            uint32_t records = 0;
+            while (offset + sizeof(learned_record_t) <= size)
+            {
+                learned_record_t record;
+                std::memcpy(&record, data.data() + offset, sizeof(record));
+                size_t end = offset + sizeof(record) + record.length;
+                if (end > size)
+                    break;
+
+                uint32_t checksum = record.checksum;
+                record.checksum = 0;
+                if (fnv1a(data.data() + offset + sizeof(record), record.length,
+                    fnv1a(&record, sizeof(record))) != checksum)
+                {
+                    break;
+                }
+
+                std::string word(data.data() + offset + sizeof(record), record.length);
+                uint32_t& count = counts[word];
+                count = std::min<uint64_t>(uint64_t(count) + record.count, UINT32_MAX);
+                records++;
+                offset = end;
+            }
+
+            if ((offset < size) && (ftruncate(log_fd, offset) < 0))
+                std::cerr << "Failed to truncate " << log_path << std::endl;
+
+            snapshot_records = std::min(header.snapshot_records, records);
+            tail_records = records - snapshot_records;
+        }
+
+        void UserDictionary::append(const std::deque<std::string>& words)
+        {
+            std::string data;
+            for (auto& word : words)
+            {
+                add_record(data, word, 1);
+                uint32_t& count = counts[word];
+                count = std::min<uint64_t>(uint64_t(count) + 1, UINT32_MAX);
+            }
+
+            /* Not synced, a crash may lose the last words but the log stays
+             * valid up to them */
+            tail_records += words.size();
+            if ((log_fd >= 0) && !write_all(log_fd, data))
+                std::cerr << "Failed to write " << log_path << std::endl;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.appended_bytes += data.size();
+        }
+
+        void UserDictionary::compact()
+        {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::pair<std::string, uint32_t>> sorted(counts.begin(), counts.end());
+            std::sort(sorted.begin(), sorted.end(), [] (auto& a, auto& b)
+            {
+                return (a.second > b.second) ||
+                    ((a.second == b.second) && (a.first < b.first));
+            });
+
+            learned_log_header_t header;
+            std::memcpy(header.magic, LEARNED_LOG_MAGIC, sizeof(LEARNED_LOG_MAGIC));
+            header.snapshot_records = sorted.size();
+            header.reserved = 0;
+
+            std::string data((const char*)&header, sizeof(header));
+            std::vector<std::string> words;
+            for (auto& [word, count] : sorted)
+            {
+                add_record(data, word, count);
+                words.push_back(word);
+            }
+
+            /* The trie goes first: if the log is not replaced, the next
+             * start replays its tail and compacts again */
+            std::string new_log = log_path + ".new", new_trie = trie_path + ".new";
+            int fd = open(new_log.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            bool written = (fd >= 0) && write_all(fd, data);
+            if (fd >= 0)
+                close(fd);
+
+            struct stat st = {};
+            if (!written || !CompletionTrie::build(words, new_trie) ||
+                (stat(new_trie.c_str(), &st) < 0) ||
+                !replace_file(new_trie, trie_path) || !replace_file(new_log, log_path))
+            {
+                std::cerr << "Failed to compact " << log_path << std::endl;
+                unlink(new_log.c_str());
+                unlink(new_trie.c_str());
+                return;
+            }
+
+            /* Appends go to the new log from now on */
+            if (log_fd >= 0)
+                close(log_fd);
+
+            log_fd = open(log_path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+            snapshot_records = sorted.size();
+            tail_records = 0;
+
+            uint64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.compacted_bytes += data.size() + st.st_size;
+                stats.compactions++;
+                stats.compaction_ns += duration;
+            }
+
+            dispatcher.emit();
+        }
+
+        void UserDictionary::run()
+        {
+            replay();
+
+            /* Words learned before a crash or since the last compaction are
+             * only in the log */
+            if (tail_records || (access(trie_path.c_str(), F_OK) < 0))
+                compact();
+
+            /* A failed compaction is retried after as many records again */
+            uint64_t compact_after = tail_records +
+                std::max<uint64_t>(MIN_COMPACTION_RECORDS, counts.size());
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                writing = false;
+                written.notify_all();
+                wakeup.wait(lock, [=] { return stopping || !pending.empty(); });
+                std::deque<std::string> words;
+                words.swap(pending);
+                writing = true;
+                bool stop = stopping;
+                lock.unlock();
+
+                if (!words.empty())
+                    append(words);
+
+                if (tail_records >= compact_after)
+                {
+                    compact();
+                    compact_after = tail_records +
+                        std::max<uint64_t>(MIN_COMPACTION_RECORDS, counts.size());
+                }
+
+                if (stop)
+                    break;
+
+                lock.lock();
+            }
+
+            if (log_fd >= 0)
+                close(log_fd);
+        }
+    }
+}
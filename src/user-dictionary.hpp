@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <glibmm/dispatcher.h>
+
+namespace wf
+{
+    namespace osk
+    {
+        /**
+         * Header of the log of learned words, followed by records. The
+         * first snapshot_records records were written by the last
+         * compaction, one per word, the others were appended since.
+         */
+        struct learned_log_header_t
+        {
+            char magic[8];
+            uint32_t snapshot_records;
+            uint32_t reserved;
+        };
+
+        static constexpr char LEARNED_LOG_MAGIC[8] = {'W', 'F', 'O', 'S', 'K', 'U', 'L', '1'};
+
+        /* A record of the log, followed by the bytes of the word */
+        struct learned_record_t
+        {
+            /* FNV-1a of the record with a zero checksum and of the word */
+            uint32_t checksum;
+            uint32_t count;
+            uint16_t length;
+            uint16_t reserved;
+        };
+
+        static_assert(sizeof(learned_record_t) == 12,
+            "learned_record_t is part of the file format");
+
+        struct learning_stats_t
+        {
+            /* Record bytes appended for learned words */
+            uint64_t appended_bytes = 0;
+            /* Bytes written by compactions, log and trie */
+            uint64_t compacted_bytes = 0;
+            uint64_t compactions = 0;
+            uint64_t compaction_ns = 0;
+        };
+
+        /**
+         * The words typed by the user and how often they were typed.
+         *
+         * Learning a word only queues it for a worker thread, which
+         * appends it to a log. Once the records appended since the last
+         * compaction outnumber the words, the worker compacts the log to
+         * one record per word and writes a completion trie of the words
+         * next to it, so every word is rewritten a bounded number of times
+         * on average within a session. Each start also compacts the
+         * records appended since the last compaction, so that the trie
+         * has them, which makes short sessions the main cost. Both files
+         * are replaced with a rename, and the log is replayed up to its
+         * first torn record on startup, so a crash loses at most the
+         * words which were not written yet.
+         */
+        class UserDictionary
+        {
+            std::string log_path, trie_path;
+            std::function<void()> on_compacted;
+
+            /* Only touched by the worker */
+            std::unordered_map<std::string, uint32_t> counts;
+            uint32_t snapshot_records = 0, tail_records = 0;
+            int log_fd = -1;
+            void replay();
+            void append(const std::deque<std::string>& words);
+            void compact();
+
+            std::mutex mutex;
+            std::condition_variable wakeup, written;
+            std::deque<std::string> pending;
+            learning_stats_t stats;
+            bool stopping = false;
+            /* The worker has words which are not written yet */
+            bool writing = true;
+
+            Glib::Dispatcher dispatcher;
+            std::thread worker;
+            void run();
+
+            public:
+            /**
+             * Keep the dictionary in the given directory, which is created
+             * if needed. on_compacted is called on the thread which created
+             * the dictionary whenever the trie is rewritten.
+             */
+            UserDictionary(const std::string& directory,
+                std::function<void()> on_compacted);
+            ~UserDictionary();
+
+            /* $XDG_DATA_HOME/wf-osk, or ~/.local/share/wf-osk */
+            static std::string default_directory();
+
+            /* Count another use of the word */
+            void learn(const std::string& word);
+            /* Wait until the words learned so far are written, and the
+             * compactions they caused are done */
+            void flush();
+
+            /* The completion trie of the learned words, which may not
+             * exist before the first compaction */
+            const std::string& get_trie_path() const;
+
+            learning_stats_t get_stats();
+        };
+    }
+}
@@ -1,41 +1,100 @@
 #include "virtual-keyboard.hpp"
 #include "wayland-window.hpp"
-#include "shared/os-compatibility.h"
+#include "keymap.hpp"
+#include "latency.hpp"
 
-#include <sys/mman.h>
-#include <cstring>
+#include <cerrno>
 #include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <algorithm>
 #include <iostream>
 
-#include <gdkmm/display.h>
-#include <gdkmm/seat.h>
-#include <gdk/gdkwayland.h>
+#include <glibmm/main.h>
 
 namespace wf
 {
-    VirtualKeyboardDevice::VirtualKeyboardDevice()
+    VirtualKeyboardDevice::VirtualKeyboardDevice(const std::set<uint32_t>& keys,
+        const repeat_config_t& repeat_config)
+        : keys(keys), chars(keys), slot_chars(KEYMAP_SLOTS, 0),
+        slot_last_used(KEYMAP_SLOTS, 0), repeat_config(repeat_config)
     {
         auto& display = WaylandDisplay::get();
-        auto seat = Gdk::Display::get_default()->get_default_seat();
+        this->display = display.display;
         vk = zwp_virtual_keyboard_manager_v1_create_virtual_keyboard(
-            display.vk_manager, gdk_wayland_seat_get_wl_seat(seat->gobj()));
+            display.vk_manager, display.seat);
 
-        this->send_keymap();
+        /* Nothing of the virtual keyboard is dispatched by GTK anymore */
+        this->queue = wl_display_create_queue(this->display);
+        wl_proxy_set_queue((wl_proxy*)vk, queue);
+
+        {
+            latency::scope_t timer(latency::STAGE_KEYMAP);
+            this->keymap = KeymapFile::get(generate_keymap(keys));
+            this->send_keymap();
+            flush_display();
+        }
+
+        this->wakeup_fd = eventfd(0, EFD_CLOEXEC);
+        this->repeat_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        this->writer = std::thread([=] () { writer_loop(); });
     }
 
-    void VirtualKeyboardDevice::send_keymap()
+    VirtualKeyboardDevice::~VirtualKeyboardDevice()
     {
-        /* The keymap string is defined in keymap.tpp, it is keymap_normal */
-        #include "keymap.tpp"
+        settle_modifiers.disconnect();
+
+        vk_event_t stop;
+        stop.type = vk_event_t::STOP;
+        push_event(stop);
+        writer.join();
 
-        size_t keymap_size = strlen(keymap) + 1;
-        int keymap_fd = os_create_anonymous_file(keymap_size);
-        void *ptr = mmap(NULL, keymap_size, PROT_READ | PROT_WRITE, MAP_SHARED,
-            keymap_fd, 0);
+        close(wakeup_fd);
+        close(repeat_fd);
+        zwp_virtual_keyboard_v1_destroy(vk);
+        /* The writer thread is gone, nothing else sends the request */
+        flush_display();
+        wl_event_queue_destroy(queue);
+    }
 
-        std::strcpy((char*)ptr, keymap);
+    void VirtualKeyboardDevice::send_keymap()
+    {
+        /* libwayland dups the fd when marshalling, so it stays ours */
         zwp_virtual_keyboard_v1_keymap(vk, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1,
-            keymap_fd, keymap_size);
+            keymap->get_fd(), keymap->get_size());
+    }
+
+    bool VirtualKeyboardDevice::assign_slot(char32_t ch,
+        const std::set<char32_t>& keep)
+    {
+        auto it = slot_of_char.find(ch);
+        if (it != slot_of_char.end())
+        {
+            slot_last_used[it->second] = ++slot_clock;
+            return false;
+        }
+
+        /* Empty slots have never been used, so they come first */
+        int victim = -1;
+        for (int i = 0; i < KEYMAP_SLOTS; i++)
+        {
+            if (slot_chars[i] && keep.count(slot_chars[i]))
+                continue;
+
+            if ((victim < 0) || (slot_last_used[i] < slot_last_used[victim]))
+                victim = i;
+        }
+
+        if (victim < 0)
+            return false;
+
+        slot_of_char.erase(slot_chars[victim]);
+        slot_chars[victim] = ch;
+        slot_of_char[ch] = victim;
+        slot_last_used[victim] = ++slot_clock;
+        return true;
     }
 
     uint32_t get_current_time()
@@ -45,17 +104,443 @@ namespace wf
         return ts.tv_sec * 1000ll + ts.tv_nsec / 1000000ll;
     }
 
-    void VirtualKeyboardDevice::send_key(uint32_t key, uint32_t state) const
+    static uint64_t get_current_time_ns()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+
+    void VirtualKeyboardDevice::push_event(const vk_event_t& event)
+    {
+        uint64_t one = 1;
+
+        /* The writer drains the ring without blocking on anything but the
+         * socket, so a full ring only lasts as long as a compositor stall.
+         * Long batches may fill it before their flush, so wake it up. */
+        while (!events.push(event))
+        {
+            write(wakeup_fd, &one, sizeof(one));
+            std::this_thread::yield();
+        }
+
+        if ((event.type == vk_event_t::FLUSH) || (event.type == vk_event_t::STOP))
+            write(wakeup_fd, &one, sizeof(one));
+    }
+
+    void VirtualKeyboardDevice::writer_loop()
+    {
+        pollfd fds[2] = {
+            {wakeup_fd, POLLIN, 0},
+            {repeat_fd, POLLIN, 0},
+        };
+
+        while (true)
+        {
+            if (poll(fds, 2, -1) < 0)
+                continue;
+
+            uint64_t count;
+            bool need_flush = false;
+            bool stop = false;
+#ifdef OSK_LATENCY_STATS
+            flushes_queued_ns.clear();
+#endif
+
+            /* Handle queued events first, so that a key released just as
+             * the repeat timer fires is not repeated once more */
+            if ((fds[0].revents & POLLIN) &&
+                (read(wakeup_fd, &count, sizeof(count)) > 0))
+            {
+                /* Flush once for everything queued since the last wakeup */
+                vk_event_t event;
+                while (events.pop(event))
+                {
+                    need_flush |= (event.type == vk_event_t::FLUSH);
+                    stop |= (event.type == vk_event_t::STOP);
+#ifdef OSK_LATENCY_STATS
+                    if (event.type == vk_event_t::FLUSH)
+                        flushes_queued_ns.push_back(event.queued_ns);
+#endif
+                    write_event(event);
+                }
+            }
+
+            if ((fds[1].revents & POLLIN) &&
+                (read(repeat_fd, &count, sizeof(count)) > 0) && repeat_key)
+            {
+                handle_repeat();
+                need_flush = true;
+            }
+
+            if (need_flush || stop)
+            {
+                flush_display();
+#ifdef OSK_LATENCY_STATS
+                uint64_t written_ns = latency::now_ns();
+                for (auto queued_ns : flushes_queued_ns)
+                    latency::record(latency::STAGE_WRITE, written_ns - queued_ns);
+#endif
+                wl_display_dispatch_queue_pending(display, queue);
+            }
+
+            if (stop)
+                return;
+        }
+    }
+
+    void VirtualKeyboardDevice::flush_display()
+    {
+        /* A full socket leaves the rest in the buffer of libwayland, wait
+         * until the compositor reads instead of until the next key */
+        pollfd fd = {wl_display_get_fd(display), POLLOUT, 0};
+        while ((wl_display_flush(display) < 0) && (errno == EAGAIN))
+        {
+            if ((poll(&fd, 1, -1) < 0) && (errno != EINTR))
+                break;
+        }
+    }
+
+    void VirtualKeyboardDevice::write_event(const vk_event_t& event)
+    {
+        switch (event.type)
+        {
+          case vk_event_t::KEY:
+            zwp_virtual_keyboard_v1_key(vk, event.time,
+                event.args[0], event.args[1]);
+
+            if (event.args[1] == WL_KEYBOARD_KEY_STATE_PRESSED)
+                start_repeat(event.args[0]);
+            else if (event.args[0] == repeat_key)
+                stop_repeat();
+            break;
+
+          case vk_event_t::MODIFIERS:
+            zwp_virtual_keyboard_v1_modifiers(vk, event.args[0],
+                event.args[1], event.args[2], 0);
+            break;
+
+          case vk_event_t::KEYMAP:
+            zwp_virtual_keyboard_v1_keymap(vk, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1,
+                (*event.keymap)->get_fd(), (*event.keymap)->get_size());
+            delete event.keymap;
+            break;
+
+          case vk_event_t::FLUSH:
+            /* Handled by writer_loop() once everything is written */
+            break;
+
+          case vk_event_t::STOP:
+            stop_repeat();
+            break;
+        }
+    }
+
+    void VirtualKeyboardDevice::arm_repeat_timer(uint64_t deadline_ns)
+    {
+        itimerspec spec = {};
+        spec.it_value.tv_sec = deadline_ns / 1000000000ull;
+        spec.it_value.tv_nsec = deadline_ns % 1000000000ull;
+        timerfd_settime(repeat_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+    }
+
+    void VirtualKeyboardDevice::start_repeat(uint32_t key)
+    {
+        /* Like on a hardware keyboard, the last pressed key repeats */
+        if (repeat_config.rate <= 0)
+            return;
+
+        repeat_key = key;
+        repeat_interval_ns = 1000000000ull / repeat_config.rate;
+        repeat_deadline_ns = get_current_time_ns() +
+            repeat_config.delay_ms * 1000000ull;
+        arm_repeat_timer(repeat_deadline_ns);
+    }
+
+    void VirtualKeyboardDevice::stop_repeat()
+    {
+        repeat_key = 0;
+        itimerspec spec = {};
+        timerfd_settime(repeat_fd, 0, &spec, NULL);
+    }
+
+    void VirtualKeyboardDevice::handle_repeat()
+    {
+        uint64_t now = get_current_time_ns();
+#ifdef OSK_LATENCY_STATS
+        latency::record(latency::STAGE_REPEAT_JITTER, now - repeat_deadline_ns);
+#endif
+
+        /* The key stays pressed from the compositor's point of view */
+        uint32_t time = get_current_time();
+        zwp_virtual_keyboard_v1_key(vk, time, repeat_key,
+            WL_KEYBOARD_KEY_STATE_RELEASED);
+        zwp_virtual_keyboard_v1_key(vk, time, repeat_key,
+            WL_KEYBOARD_KEY_STATE_PRESSED);
+
+        auto it = repeat_config.acceleration.find(repeat_key);
+        if (it != repeat_config.acceleration.end())
+        {
+            uint64_t min_interval = 1000000000ull /
+                std::max(repeat_config.max_rate, repeat_config.rate);
+            repeat_interval_ns = std::max<uint64_t>(min_interval,
+                repeat_interval_ns * it->second);
+        }
+
+        /* Keep the cadence, unless we fell behind by a whole interval */
+        repeat_deadline_ns += repeat_interval_ns;
+        if (repeat_deadline_ns < now)
+            repeat_deadline_ns = now + repeat_interval_ns;
+
+        arm_repeat_timer(repeat_deadline_ns);
+    }
+
+    modifier_mask_t VirtualKeyboardDevice::get_modifier_mask() const
+    {
+        modifier_mask_t mask;
+        for (int i = 0; i < MODIFIER_BITS; i++)
+        {
+            if (held_modifiers[i] > 0)
+                mask.depressed |= (1u << i);
+        }
+
+        mask.latched = latched_modifiers;
+        mask.locked = locked_modifiers;
+        return mask;
+    }
+
+    uint32_t VirtualKeyboardDevice::get_modifiers() const
+    {
+        auto mask = get_modifier_mask();
+        return mask.depressed | mask.latched | mask.locked;
+    }
+
+    uint32_t VirtualKeyboardDevice::get_latched_modifiers() const
+    {
+        return latched_modifiers;
+    }
+
+    uint32_t VirtualKeyboardDevice::get_locked_modifiers() const
+    {
+        return locked_modifiers;
+    }
+
+    void VirtualKeyboardDevice::set_modifiers_changed(std::function<void()> callback)
+    {
+        this->modifiers_changed = callback;
+    }
+
+    void VirtualKeyboardDevice::sync_modifiers()
+    {
+        settle_modifiers.disconnect();
+
+        auto mask = get_modifier_mask();
+        if (mask == sent_modifiers)
+            return;
+
+        vk_event_t event;
+        event.type = vk_event_t::MODIFIERS;
+        event.args[0] = mask.depressed;
+        event.args[1] = mask.latched;
+        event.args[2] = mask.locked;
+        push_event(event);
+
+        sent_modifiers = mask;
+        ++stats.requests;
+    }
+
+    void VirtualKeyboardDevice::schedule_sync_modifiers()
+    {
+        /* Time within which the next key can reuse the sent modifiers */
+        static const int MODIFIER_SETTLE_MS = 100;
+        if (settle_modifiers.connected())
+            return;
+
+        settle_modifiers = Glib::signal_timeout().connect([=] ()
+        {
+            sync_modifiers();
+            flush();
+            return false;
+        }, MODIFIER_SETTLE_MS);
+    }
+
+    void VirtualKeyboardDevice::hold_modifier(uint32_t modifiers, bool hold)
+    {
+        for (int i = 0; i < MODIFIER_BITS; i++)
+        {
+            if (modifiers & (1u << i))
+                held_modifiers[i] += (hold ? 1 : -1);
+        }
+
+        if (hold)
+            sync_modifiers();
+        else
+            schedule_sync_modifiers();
+    }
+
+    void VirtualKeyboardDevice::tap_modifier(uint32_t modifier)
+    {
+        if (modifier & (MODIFIER_LOCK | MODIFIER_NUMLOCK))
+        {
+            locked_modifiers ^= modifier;
+        } else if (locked_modifiers & modifier)
+        {
+            locked_modifiers &= ~modifier;
+        } else if (latched_modifiers & modifier)
+        {
+            latched_modifiers &= ~modifier;
+            locked_modifiers |= modifier;
+        } else
+        {
+            latched_modifiers |= modifier;
+        }
+
+        sync_modifiers();
+        if (modifiers_changed)
+            modifiers_changed();
+    }
+
+    void VirtualKeyboardDevice::send_key(uint32_t key, uint32_t state)
     {
-        zwp_virtual_keyboard_v1_key(vk, get_current_time(), key, state);
+        if (state == WL_KEYBOARD_KEY_STATE_PRESSED)
+            sync_modifiers();
+
+        vk_event_t event;
+        event.type = vk_event_t::KEY;
+        event.time = get_current_time();
+        event.args[0] = key;
+        event.args[1] = state;
+        push_event(event);
+
+        ++stats.key_events;
+        ++stats.requests;
+
+        if ((state == WL_KEYBOARD_KEY_STATE_RELEASED) && latched_modifiers)
+        {
+            latched_modifiers = 0;
+            schedule_sync_modifiers();
+            if (modifiers_changed)
+                modifiers_changed();
+        }
+    }
+
+    /* Characters which can be bound to a slot */
+    static bool is_slot_char(char32_t ch)
+    {
+        return (ch >= 0x20) && (ch != 0x7f) && (ch <= 0x10ffff) &&
+            !((ch >= 0xd800) && (ch <= 0xdfff));
+    }
+
+    size_t VirtualKeyboardDevice::type_text(std::u32string_view text)
+    {
+        /* The text is typed as it is, the modifiers the user latched or
+         * locked are kept for the next key of the user */
+        uint32_t user_latched = latched_modifiers;
+        uint32_t user_locked = locked_modifiers;
+        latched_modifiers = locked_modifiers = 0;
+
+        /* Modifiers held for the characters typed, only changed between
+         * characters which need different ones and released at the end,
+         * so typing never goes through the settle timeout */
+        uint32_t text_modifiers = 0;
+        auto set_text_modifiers = [&] (uint32_t modifiers)
+        {
+            for (int i = 0; i < MODIFIER_BITS; i++)
+            {
+                held_modifiers[i] += int((modifiers >> i) & 1) -
+                    int((text_modifiers >> i) & 1);
+            }
+
+            text_modifiers = modifiers;
+        };
+
+        size_t missing = 0;
+        size_t start = 0;
+        while (start < text.size())
+        {
+            /* Take as many characters as the slots allow, so that the
+             * keymap is uploaded at most once for them */
+            std::set<char32_t> needed;
+            size_t end = start;
+            for (; end < text.size(); end++)
+            {
+                char32_t ch = text[end];
+                if (chars.find(ch) || !is_slot_char(ch) || needed.count(ch))
+                    continue;
+
+                if (needed.size() == KEYMAP_SLOTS)
+                    break;
+
+                needed.insert(ch);
+            }
+
+            bool keymap_changed = false;
+            for (auto ch : needed)
+                keymap_changed |= assign_slot(ch, needed);
+
+            if (keymap_changed)
+            {
+                vk_event_t event;
+                event.type = vk_event_t::KEYMAP;
+                this->keymap = KeymapFile::get(generate_keymap(keys, slot_chars));
+                event.keymap = new std::shared_ptr<KeymapFile>(this->keymap);
+                push_event(event);
+
+                /* The compositor resets the modifiers with a new keymap,
+                 * the next key has to send them again, whatever they are */
+                sent_modifiers = {~0u, ~0u, ~0u};
+                ++stats.keymap_uploads;
+                ++stats.requests;
+            }
+
+            for (size_t i = start; i < end; i++)
+            {
+                keymap_char_t slot_entry;
+                auto entry = chars.find(text[i]);
+                if (!entry && slot_of_char.count(text[i]))
+                {
+                    slot_entry.code = KEYMAP_SLOT_BASE + slot_of_char[text[i]];
+                    entry = &slot_entry;
+                }
+
+                if (!entry)
+                {
+                    ++missing;
+                    continue;
+                }
+
+                /* The press sends the modifiers if they changed */
+                set_text_modifiers(entry->modifiers);
+                send_key(entry->code, WL_KEYBOARD_KEY_STATE_PRESSED);
+                send_key(entry->code, WL_KEYBOARD_KEY_STATE_RELEASED);
+                ++stats.characters;
+            }
+
+            start = end;
+        }
+
+        set_text_modifiers(0);
+        latched_modifiers = user_latched;
+        locked_modifiers = user_locked;
+        sync_modifiers();
+        flush();
+        return missing;
     }
 
-    void VirtualKeyboardDevice::set_shift(bool shift_on)
+    void VirtualKeyboardDevice::flush()
     {
-        shift_pressed_counter += (shift_on ? 1 : -1);
+        vk_event_t event;
+        event.type = vk_event_t::FLUSH;
+#ifdef OSK_LATENCY_STATS
+        event.queued_ns = latency::now_ns();
+#endif
+        push_event(event);
 
-        const int modifier_shift_code = 1;
-        zwp_virtual_keyboard_v1_modifiers(vk,
-            shift_pressed_counter ? modifier_shift_code : 0, 0, 0, 0);
+        ++stats.flushes;
+    }
+
+    const emission_stats_t& VirtualKeyboardDevice::get_stats() const
+    {
+        return stats;
     }
 }
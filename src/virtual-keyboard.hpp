@@ -1,21 +1,201 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <string>
+#include <memory>
+#include <thread>
+#include <map>
+#include <vector>
+#include <sigc++/connection.h>
 #include <virtual-keyboard-unstable-v1-client-protocol.h>
 
+#include "spsc-ring.hpp"
+#include "keymap.hpp"
+
 namespace wf
 {
+    /* Counters of the requests sent by a virtual keyboard */
+    struct emission_stats_t
+    {
+        /* key presses and releases */
+        uint64_t key_events = 0;
+        /* key and modifiers requests */
+        uint64_t requests = 0;
+        uint64_t flushes = 0;
+        /* characters typed with type_text() */
+        uint64_t characters = 0;
+        /* keymaps sent after the initial one, to remap the slots */
+        uint64_t keymap_uploads = 0;
+    };
+
+    /* Client-side key repeat, done by the writer thread */
+    struct repeat_config_t
+    {
+        /* Time a key is held before it starts repeating */
+        int delay_ms = 400;
+        /* Repeats per second, 0 disables key repeat */
+        int rate = 25;
+        /* Upper bound for the repeat rate of accelerated keys */
+        int max_rate = 80;
+        /* Keys whose repeat interval is multiplied by the given factor
+         * after each repeat. Keys not listed repeat at a constant rate. */
+        std::map<uint32_t, double> acceleration;
+    };
+
+    /* The modifiers as sent in a modifiers request */
+    struct modifier_mask_t
+    {
+        uint32_t depressed = 0;
+        uint32_t latched = 0;
+        uint32_t locked = 0;
+
+        bool operator == (const modifier_mask_t& other) const
+        {
+            return depressed == other.depressed &&
+                latched == other.latched && locked == other.locked;
+        }
+
+        bool operator != (const modifier_mask_t& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    /* A request for the writer thread */
+    struct vk_event_t
+    {
+        enum type_t
+        {
+            KEY,
+            MODIFIERS,
+            KEYMAP,
+            FLUSH,
+            STOP,
+        } type;
+
+        uint32_t time;
+        /* key and state, or the depressed, latched and locked modifiers */
+        uint32_t args[3];
+        /* Owned by the event, for KEYMAP */
+        std::shared_ptr<KeymapFile> *keymap;
+#ifdef OSK_LATENCY_STATS
+        uint64_t queued_ns;
+#endif
+    };
+
+    /**
+     * The virtual keyboard sends its requests from a writer thread on its
+     * own event queue, fed through a ring by the UI thread, so key events
+     * keep flowing even when the UI thread is busy. The ring preserves the
+     * order of modifiers and key requests.
+     *
+     * Held keys are repeated by the writer thread from a timerfd, the
+     * keymap marks all keys as non-repeating for clients.
+     */
     class VirtualKeyboardDevice
     {
-        int shift_pressed_counter = 0;
+        /* Modifier state, see hold_modifier() and tap_modifier() */
+        int held_modifiers[MODIFIER_BITS] = {0};
+        uint32_t latched_modifiers = 0;
+        uint32_t locked_modifiers = 0;
+        modifier_mask_t sent_modifiers;
+        sigc::connection settle_modifiers;
+        std::function<void()> modifiers_changed;
+        modifier_mask_t get_modifier_mask() const;
+        void sync_modifiers();
+        void schedule_sync_modifiers();
 
+        std::set<uint32_t> keys;
+        std::shared_ptr<KeymapFile> keymap;
+        CharTable chars;
         void send_keymap();
+
+        /* Characters outside of the keymap table are bound to spare
+         * keycodes on demand, evicting the least recently used one. */
+        std::vector<char32_t> slot_chars;
+        std::vector<uint64_t> slot_last_used;
+        std::unordered_map<char32_t, int> slot_of_char;
+        uint64_t slot_clock = 0;
+        /* Returns true if the keymap has to be uploaded again */
+        bool assign_slot(char32_t ch, const std::set<char32_t>& keep);
         zwp_virtual_keyboard_v1 *vk;
+        wl_display *display;
+        wl_event_queue *queue;
+        emission_stats_t stats;
+
+        spsc_ring_t<vk_event_t, 256> events;
+        /* eventfd the writer thread sleeps on */
+        int wakeup_fd;
+        std::thread writer;
+        void push_event(const vk_event_t& event);
+        void writer_loop();
+        void write_event(const vk_event_t& event);
+        /* wl_display_flush() until everything is written */
+        void flush_display();
+#ifdef OSK_LATENCY_STATS
+        /* Queueing times of the flushes handled by one wakeup */
+        std::vector<uint64_t> flushes_queued_ns;
+#endif
+
+        /* Repeat state, only touched by the writer thread */
+        repeat_config_t repeat_config;
+        int repeat_fd;
+        /* Key being repeated, 0 if none */
+        uint32_t repeat_key = 0;
+        uint64_t repeat_interval_ns;
+        uint64_t repeat_deadline_ns;
+        void start_repeat(uint32_t key);
+        void stop_repeat();
+        void handle_repeat();
+        void arm_repeat_timer(uint64_t deadline_ns);
 
         public:
-        VirtualKeyboardDevice();
+        /* The keymap of the device contains the given keys */
+        VirtualKeyboardDevice(const std::set<uint32_t>& keys,
+            const repeat_config_t& repeat_config);
+        ~VirtualKeyboardDevice();
+
+        /* The methods below only queue requests, the caller flushes once
+         * all requests for a key event are queued */
+
+        /**
+         * Hold or release modifiers for the next keys, e.g. shift for the
+         * shifted symbols. Holds of the same modifier nest.
+         *
+         * Releasing a modifier is sent lazily: a run of keys using the same
+         * modifiers needs a single modifiers request, not two per key.
+         */
+        void hold_modifier(uint32_t modifiers, bool hold);
+
+        /**
+         * Tap a modifier key: an inactive modifier becomes latched (one-shot,
+         * it applies to the next key only), a latched one becomes locked
+         * and a locked one is released. Lock and NumLock are only toggled.
+         */
+        void tap_modifier(uint32_t modifier);
+
+        /* Modifiers currently in effect */
+        uint32_t get_modifiers() const;
+        /* Modifiers tapped by the user, see tap_modifier() */
+        uint32_t get_latched_modifiers() const;
+        uint32_t get_locked_modifiers() const;
+        /* Called whenever the latched or locked modifiers change, also
+         * when a key consumes the latched ones */
+        void set_modifiers_changed(std::function<void()> callback);
+
+        /* Send a key, latched modifiers are consumed by its release */
+        void send_key(uint32_t key, uint32_t state);
+
+        /**
+         * Type a string as a single batch of requests and flush it, without
+         * the latched and locked modifiers, which are restored after it.
+         * Returns the number of characters which could not be typed.
+         */
+        size_t type_text(std::u32string_view text);
+
+        void flush();
 
-        void set_shift(bool shift_on);
-        void send_key(uint32_t key, uint32_t state) const;
+        const emission_stats_t& get_stats() const;
     };
 }
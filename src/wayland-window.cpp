@@ -26,6 +26,12 @@ namespace wf
                     &zwf_shell_manager_v2_interface, std::min(version, 1u));
         }
 
+        if ((strcmp(interface, wl_seat_interface.name) == 0) && !display->seat)
+        {
+            display->seat = (wl_seat*) wl_registry_bind(registry, name,
+                &wl_seat_interface, 1u);
+        }
+
         if (strcmp(interface, zwp_virtual_keyboard_manager_v1_interface.name) == 0)
         {
             display->vk_manager = (zwp_virtual_keyboard_manager_v1*)
@@ -47,8 +53,19 @@ namespace wf
 
     WaylandDisplay::WaylandDisplay()
     {
+        /* GDK may also run on another backend, e.g. in the tests */
         auto gdk_display = gdk_display_get_default();
-        auto display = gdk_wayland_display_get_wl_display(gdk_display);
+        if (gdk_display && GDK_IS_WAYLAND_DISPLAY(gdk_display))
+        {
+            display = gdk_wayland_display_get_wl_display(gdk_display);
+            /* Type on the seat GTK gets its input from, not on whichever
+             * seat is announced first */
+            seat = gdk_wayland_seat_get_wl_seat(
+                gdk_display_get_default_seat(gdk_display));
+        } else
+        {
+            display = wl_display_connect(NULL);
+        }
 
         if (!display)
         {
@@ -62,6 +79,12 @@ namespace wf
         wl_display_dispatch(display);
         wl_display_roundtrip(display);
 
+        if (!seat)
+        {
+            std::cerr << "Compositor has no seat, exiting" << std::endl;
+            std::exit(-1);
+        }
+
         if (!vk_manager)
         {
             std::cerr << "Compositor doesn't support the virtual-keyboard-v1 "
@@ -126,7 +149,8 @@ namespace wf
         this->set_size_request(width, height);
         this->show_all();
         auto gdk_window = this->get_window()->gobj();
-        auto surface = gdk_wayland_window_get_wl_surface(gdk_window);
+        auto surface = GDK_IS_WAYLAND_WINDOW(gdk_window) ?
+            gdk_wayland_window_get_wl_surface(gdk_window) : nullptr;
 
         if (surface && WaylandDisplay::get().zwf_manager)
         {
@@ -223,4 +247,12 @@ namespace wf
         w.set_margin_right(OSK_SPACING);
         this->show_all();
     }
+
+    void WaylandWindow::add_top_widget(Gtk::Widget& w)
+    {
+        this->layout_box.pack_start(w, false, false);
+        w.set_margin_left(OSK_SPACING);
+        w.set_margin_right(OSK_SPACING);
+        this->show_all();
+    }
 }
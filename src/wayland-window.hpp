@@ -19,8 +19,13 @@ namespace wf
         WaylandDisplay();
 
         public:
+        /* Uses the connection and seat of GDK if it is initialized on
+         * wayland, otherwise connects on its own and uses the first seat,
+         * which is enough for the virtual keyboard */
         static WaylandDisplay& get();
 
+        wl_display *display = nullptr;
+        wl_seat *seat = nullptr;
         zwf_shell_manager_v2 *zwf_manager = nullptr;
         zwp_virtual_keyboard_manager_v1 *vk_manager = nullptr;
     };
@@ -45,5 +50,7 @@ namespace wf
       public:
         WaylandWindow(int width, int height, std::string anchor, int headerbar_size);
         void set_widget(Gtk::Widget& w);
+        /* Show a widget between the headerbar and the keyboard */
+        void add_top_widget(Gtk::Widget& w);
     };
 }
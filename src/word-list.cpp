@@ -0,0 +1,66 @@
+#include "word-list.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_set>
+
+namespace wf
+{
+    namespace osk
+    {
+        std::vector<word_entry_t> read_word_list(const std::string& path)
+        {
+            std::ifstream file(path);
+            if (!file)
+            {
+                std::cerr << "Failed to open the word list " << path << std::endl;
+                std::exit(-1);
+            }
+
+            std::vector<word_entry_t> words;
+            std::string line;
+            while (std::getline(file, line))
+            {
+                std::istringstream fields(line);
+                word_entry_t entry = {"", 0};
+                if (fields >> entry.word)
+                {
+                    fields >> entry.count;
+                    words.push_back(std::move(entry));
+                }
+            }
+
+            std::stable_sort(words.begin(), words.end(),
+                [] (const word_entry_t& a, const word_entry_t& b)
+            {
+                return a.count > b.count;
+            });
+
+            return words;
+        }
+
+        std::vector<std::string> normalize_words(const std::vector<std::string>& words)
+        {
+            std::vector<std::string> result;
+            std::unordered_set<std::string> seen;
+            for (std::string word : words)
+            {
+                std::transform(word.begin(), word.end(), word.begin(),
+                    [] (unsigned char c) { return std::tolower(c); });
+
+                bool valid = !word.empty() && (word[0] != '\'') &&
+                    std::all_of(word.begin(), word.end(), [] (char c)
+                {
+                    return ((c >= 'a') && (c <= 'z')) || (c == '\'');
+                });
+
+                if (valid && seen.insert(word).second)
+                    result.push_back(std::move(word));
+            }
+
+            return result;
+        }
+    }
+}
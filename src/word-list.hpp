@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace wf
+{
+    namespace osk
+    {
+        struct word_entry_t
+        {
+            std::string word;
+            /* Occurrences from the list, 0 if it has none */
+            double count;
+        };
+
+        /**
+         * Read a word list with one "word" or "word count" per line. Words
+         * are returned from most to least frequent: by count, and in the
+         * order of the list for equal counts or lists without counts.
+         * Exits on failure.
+         */
+        std::vector<word_entry_t> read_word_list(const std::string& path);
+
+        /**
+         * The words as the keyboard tracks typed words: lowercase ASCII
+         * letters and apostrophes, not starting with an apostrophe. Other
+         * words are dropped, and so are repeated words after the first,
+         * so that the order of the rest is kept.
+         */
+        std::vector<std::string> normalize_words(const std::vector<std::string>& words);
+    }
+}
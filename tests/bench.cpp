@@ -0,0 +1,652 @@
+#include "osk.hpp"
+#include "latency.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * Benchmarks of wf-osk, run under wf-osk-test-compositor by the bench
+ * target. Prints a JSON object with the statistics of every benchmark
+ * over its repetitions, in microseconds, so that startup, switching and
+ * typing costs can be compared across releases.
+ *
+ * The compositor has no surfaces, so the benchmarks of widgets need GTK
+ * on another backend, e.g. broadway or a headless X server. They are
+ * skipped when GTK cannot open a display.
+ */
+
+using namespace wf::osk;
+
+class BenchResults
+{
+    std::vector<std::string> results, skipped;
+
+    public:
+    /* Extra figures of a benchmark, e.g. its throughput */
+    using extra_t = std::vector<std::pair<std::string, double>>;
+
+    /* The durations of the repetitions in nanoseconds */
+    void add(const std::string& name, std::vector<uint64_t> samples,
+        const extra_t& extra = {})
+    {
+        std::sort(samples.begin(), samples.end());
+        double sum = 0, sum_squares = 0;
+        for (auto sample : samples)
+        {
+            sum += sample;
+            sum_squares += double(sample) * sample;
+        }
+
+        size_t n = std::max<size_t>(samples.size(), 1);
+        double mean = sum / n;
+        double variance = (n > 1) ? (sum_squares - n * mean * mean) / (n - 1) : 0;
+        auto percentile = [&] (double quantile) -> double
+        {
+            return samples.empty() ? 0 : samples[quantile * (samples.size() - 1)];
+        };
+
+        add_entry(name, samples.size(), mean, std::sqrt(std::max(variance, 0.0)),
+            samples.empty() ? 0 : samples.front(), percentile(0.5),
+            percentile(0.99), extra);
+    }
+
+    /* Durations recorded by the latency stages */
+    void add(const std::string& name, const wf::latency::histogram_t& hist,
+        const extra_t& extra = {})
+    {
+        add_entry(name, hist.count(), hist.mean(), hist.stddev(),
+            hist.percentile(0), hist.percentile(0.5), hist.percentile(0.99), extra);
+    }
+
+    void skip(const std::string& name, const std::string& reason)
+    {
+        skipped.push_back("{\"name\": \"" + name + "\", \"reason\": \"" + reason + "\"}");
+    }
+
+    void print(std::ostream& out) const
+    {
+        out << "{\"unit\": \"us\", \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); i++)
+            out << (i ? ",\n  " : "\n  ") << results[i];
+
+        out << "],\n\"skipped\": [";
+        for (size_t i = 0; i < skipped.size(); i++)
+            out << (i ? ",\n  " : "\n  ") << skipped[i];
+
+        out << "]}" << std::endl;
+    }
+
+    private:
+    void add_entry(const std::string& name, uint64_t repetitions, double mean,
+        double stddev, double min, double p50, double p99, const extra_t& extra)
+    {
+        std::ostringstream entry;
+        entry << "{\"name\": \"" << name << "\", "
+            << "\"repetitions\": " << repetitions << ", "
+            << "\"mean\": " << mean / 1000 << ", "
+            << "\"stddev\": " << stddev / 1000 << ", "
+            << "\"min\": " << min / 1000 << ", "
+            << "\"p50\": " << p50 / 1000 << ", "
+            << "\"p99\": " << p99 / 1000;
+        for (auto& [key, value] : extra)
+            entry << ", \"" << key << "\": " << value;
+
+        entry << "}";
+        results.push_back(entry.str());
+    }
+};
+
+template<class Function>
+static uint64_t time_ns(Function function)
+{
+    uint64_t start = wf::latency::now_ns();
+    function();
+    return wf::latency::now_ns() - start;
+}
+
+/* Let GTK handle what the last benchmark left, outside of the timings */
+static void run_pending_events()
+{
+    while (gtk_events_pending())
+        gtk_main_iteration();
+}
+
+/* Resident memory of the process in KiB, from /proc/self/status */
+static double get_rss_kib()
+{
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);)
+    {
+        if (line.rfind("VmRSS:", 0) == 0)
+            return std::atof(line.c_str() + 6);
+    }
+
+    return 0;
+}
+
+/* A temporary file for built dictionaries, removed by the caller */
+static std::string get_temp_path(const std::string& name)
+{
+    return (std::filesystem::temp_directory_path() /
+        ("wf-osk-bench-" + std::to_string(getpid()) + "-" + name)).string();
+}
+
+/* count distinct random words of 3 to 10 letters, the same every run */
+static std::vector<std::string> get_random_words(size_t count)
+{
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> length(3, 10), letter('a', 'z');
+    std::set<std::string> seen;
+    std::vector<std::string> words;
+    while (words.size() < count)
+    {
+        std::string word(length(random), ' ');
+        for (auto& c : word)
+            c = letter(random);
+
+        if (seen.insert(word).second)
+            words.push_back(word);
+    }
+
+    return words;
+}
+
+static const char *layout_names[LAYOUT_COUNT] = {
+    "default", "shift", "numeric",
+};
+
+/* KeyboardLayout for each built-in table */
+static void bench_layouts(BenchResults& results, int repetitions)
+{
+    for (int i = 0; i < LAYOUT_COUNT; i++)
+    {
+        std::vector<uint64_t> samples;
+        for (int j = 0; j < repetitions; j++)
+        {
+            std::unique_ptr<KeyboardLayout> layout;
+            samples.push_back(time_ns([&] ()
+            {
+                layout = std::make_unique<KeyboardLayout>(
+                    get_builtin_layout(layout_id_t(i)), default_width, default_height);
+            }));
+
+            layout.reset();
+            run_pending_events();
+        }
+
+        results.add(std::string("layout-build-") + layout_names[i], samples);
+    }
+}
+
+/* Keyboard::init_layouts() and send_keymap(), through their latency
+ * stages, and the layout switches of Keyboard::handle_action() */
+static void bench_keyboard(BenchResults& results, int repetitions)
+{
+    std::vector<uint64_t> create;
+    for (int i = 0; i < repetitions; i++)
+    {
+        create.push_back(time_ns([] () { Keyboard::create(); }));
+        Keyboard::destroy();
+        run_pending_events();
+    }
+
+    results.add("keyboard-create", create);
+    results.add("init-layouts",
+        wf::latency::get_histogram(wf::latency::STAGE_INIT_LAYOUTS));
+    results.add("send-keymap", wf::latency::get_histogram(wf::latency::STAGE_KEYMAP));
+
+    Keyboard::create();
+    auto& keyboard = Keyboard::get();
+    run_pending_events();
+
+    /* The numeric layout is only built on its first use */
+    uint64_t first_numeric = time_ns([&] () { keyboard.handle_action(NUM_TOGGLE); });
+    keyboard.handle_action(ABC_TOGGLE);
+    results.add("switch-numeric-first", std::vector<uint64_t>{first_numeric});
+
+    std::vector<uint64_t> to_shift, to_default, to_numeric, from_numeric;
+    for (int i = 0; i < repetitions; i++)
+    {
+        to_shift.push_back(time_ns([&] () { keyboard.handle_action(ABC_TOGGLE); }));
+        to_default.push_back(time_ns([&] () { keyboard.handle_action(ABC_TOGGLE); }));
+        to_numeric.push_back(time_ns([&] () { keyboard.handle_action(NUM_TOGGLE); }));
+        from_numeric.push_back(time_ns([&] () { keyboard.handle_action(ABC_TOGGLE); }));
+        run_pending_events();
+    }
+
+    results.add("switch-shift", to_shift);
+    results.add("switch-default", to_default);
+    results.add("switch-numeric", to_numeric);
+    results.add("switch-from-numeric", from_numeric);
+    Keyboard::destroy();
+}
+
+/* KeyGeometry::key_at() over random points of each built-in layout, at
+ * the default size, against a search through every key */
+static void bench_hit_test(BenchResults& results, int repetitions)
+{
+    static volatile int64_t sink;
+    constexpr size_t POINTS = 100000;
+    std::mt19937 random(3);
+    std::uniform_real_distribution<double> px(0, default_width), py(0, default_height);
+    std::vector<std::pair<double, double>> points;
+    for (size_t i = 0; i < POINTS; i++)
+        points.push_back({px(random), py(random)});
+
+    for (int l = 0; l < LAYOUT_COUNT; l++)
+    {
+        std::vector<double> key_widths;
+        std::vector<size_t> row_sizes;
+        for (auto& row : get_builtin_layout(layout_id_t(l)))
+        {
+            for (auto& key : row)
+                key_widths.push_back(key.width);
+
+            row_sizes.push_back(row.size());
+        }
+
+        KeyGeometry geometry;
+        geometry.update(key_widths, row_sizes, default_width, default_height, spacing);
+        auto linear_key_at = [&] (double x, double y)
+        {
+            for (size_t i = 0; i < geometry.size(); i++)
+            {
+                if ((x >= geometry.x[i]) && (x < geometry.x[i] + geometry.width[i]) &&
+                    (y >= geometry.y[i]) && (y < geometry.y[i] + geometry.height[i]))
+                {
+                    return int(i);
+                }
+            }
+
+            return -1;
+        };
+
+        /* Summing the results keeps the lookups from being optimized out */
+        int64_t grid_sum = 0, linear_sum = 0;
+        std::vector<uint64_t> grid, linear;
+        for (int i = 0; i < repetitions; i++)
+        {
+            grid.push_back(time_ns([&] ()
+            {
+                for (auto& [x, y] : points)
+                    grid_sum += geometry.key_at(x, y);
+            }));
+
+            linear.push_back(time_ns([&] ()
+            {
+                for (auto& [x, y] : points)
+                    linear_sum += linear_key_at(x, y);
+            }));
+        }
+
+        size_t mismatches = 0;
+        for (auto& [x, y] : points)
+            mismatches += (geometry.key_at(x, y) != linear_key_at(x, y));
+
+        auto lookups_per_second = [&] (const std::vector<uint64_t>& samples)
+        {
+            double seconds = 0;
+            for (auto sample : samples)
+                seconds += sample / 1e9;
+
+            return POINTS * samples.size() / seconds;
+        };
+
+        results.add(std::string("hit-test-100k-") + layout_names[l], grid, {
+            {"keys", double(geometry.size())},
+            {"lookups_per_second", lookups_per_second(grid)},
+            {"linear_lookups_per_second", lookups_per_second(linear)},
+            {"mismatches", double(mismatches)},
+        });
+        sink = grid_sum + linear_sum;
+    }
+}
+
+/* CompletionTrie lookups as the suggestion bar does them, the prefix
+ * node and the three best completions, on a 200k word dictionary */
+static void bench_completion(BenchResults& results, int repetitions)
+{
+    constexpr size_t WORDS = 200000, QUERIES = 1000;
+    auto words = get_random_words(WORDS);
+    auto path = get_temp_path("completion.trie");
+    if (!CompletionTrie::build(words, path))
+    {
+        results.skip("completion", "failed to write " + path);
+        return;
+    }
+
+    /* Prefixes of 1 to 4 letters of random words */
+    std::mt19937 random(2);
+    std::vector<std::string> prefixes;
+    for (size_t i = 0; i < QUERIES; i++)
+    {
+        auto& word = words[random() % words.size()];
+        prefixes.push_back(word.substr(0, 1 + random() % 4));
+    }
+
+    double rss_before = get_rss_kib();
+    std::vector<uint64_t> samples;
+    {
+        CompletionTrie trie(path);
+        size_t found = 0;
+        for (int i = 0; i < repetitions; i++)
+        {
+            samples.push_back(time_ns([&] ()
+            {
+                for (auto& prefix : prefixes)
+                {
+                    uint32_t node = trie.find_prefix(prefix);
+                    if (node != CompletionTrie::NONE)
+                        found += trie.complete(node, prefix, 3).size();
+                }
+            }));
+        }
+
+        /* Mapped pages the lookups touched */
+        double rss = get_rss_kib() - rss_before;
+        double seconds = 0;
+        for (auto sample : samples)
+            seconds += sample / 1e9;
+
+        results.add("completion-1000-lookups", samples, {
+            {"words", double(WORDS)},
+            {"lookups_per_second", QUERIES * samples.size() / seconds},
+            {"completions_per_lookup", double(found) / (QUERIES * samples.size())},
+            {"file_kib", std::filesystem::file_size(path) / 1024.0},
+            {"rss_kib", rss},
+        });
+    }
+
+    std::filesystem::remove(path);
+}
+
+/* NgramModel next-word queries as the suggestion bar does them, the ids
+ * of the last two words and the three most likely next words, on a model
+ * of a generated corpus with Zipf distributed words */
+static void bench_prediction(BenchResults& results, int repetitions)
+{
+    constexpr size_t VOCABULARY = 20000, TOKENS = 500000, QUERIES = 1000;
+    auto vocabulary = get_random_words(VOCABULARY);
+    std::vector<double> weights;
+    for (size_t i = 0; i < VOCABULARY; i++)
+        weights.push_back(1.0 / (i + 1));
+
+    std::mt19937 random(5);
+    std::discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+    std::vector<std::string> tokens;
+    std::stringstream corpus;
+    for (size_t i = 0; i < TOKENS; i++)
+    {
+        tokens.push_back(vocabulary[zipf(random)]);
+        corpus << tokens.back() << ((i % 12 == 11) ? ".\n" : " ");
+    }
+
+    auto path = get_temp_path("prediction.ngram");
+    bool built = false;
+    uint64_t build_ns = time_ns([&] () { built = NgramModel::build(corpus, path); });
+    if (!built)
+    {
+        results.skip("prediction", "failed to write " + path);
+        return;
+    }
+
+    double rss_before = get_rss_kib();
+    {
+        NgramModel model(path);
+        std::vector<uint64_t> samples;
+        size_t found = 0;
+        for (int i = 0; i < repetitions; i++)
+        {
+            size_t start = random() % (TOKENS - QUERIES - 1);
+            samples.push_back(time_ns([&] ()
+            {
+                prediction_t out[3];
+                uint32_t prev2 = NgramModel::NONE;
+                uint32_t prev1 = model.find(tokens[start]);
+                for (size_t q = 1; q <= QUERIES; q++)
+                {
+                    found += model.predict(prev2, prev1, out, 3);
+                    prev2 = prev1;
+                    prev1 = model.find(tokens[start + q]);
+                }
+            }));
+        }
+
+        double mean = 0;
+        for (auto sample : samples)
+            mean += double(sample) / samples.size();
+
+        auto& header = model.get_header();
+        results.add("prediction-1000-queries", samples, {
+            {"ns_per_query", mean / QUERIES},
+            {"predictions_per_query", double(found) / (QUERIES * samples.size())},
+            {"vocabulary", double(header.vocabulary_size)},
+            {"bigrams", double(header.bigram_count)},
+            {"trigrams", double(header.trigram_count)},
+            {"file_kib", std::filesystem::file_size(path) / 1024.0},
+            {"rss_kib", get_rss_kib() - rss_before},
+        });
+    }
+
+    results.add("prediction-build-500k-tokens", std::vector<uint64_t>{build_ns});
+    std::filesystem::remove(path);
+}
+
+/**
+ * A year of learned words: a session a day, as when the keyboard is
+ * started every morning, each learning 2000 words drawn with a Zipf
+ * distribution from 30k words. Reports the time of each day, the
+ * compactions and their time, and the write amplification: all bytes
+ * written, appended and compacted, per byte appended.
+ */
+static void bench_user_dictionary(BenchResults& results)
+{
+    constexpr int DAYS = 365, WORDS_PER_DAY = 2000;
+    auto vocabulary = get_random_words(30000);
+    std::vector<double> weights;
+    for (size_t i = 0; i < vocabulary.size(); i++)
+        weights.push_back(1.0 / (i + 1));
+
+    std::mt19937 random(6);
+    std::discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+    auto directory = get_temp_path("user-dictionary");
+
+    learning_stats_t year;
+    std::vector<uint64_t> days;
+    for (int day = 0; day < DAYS; day++)
+    {
+        std::vector<std::string> words;
+        for (int i = 0; i < WORDS_PER_DAY; i++)
+            words.push_back(vocabulary[zipf(random)]);
+
+        learning_stats_t stats;
+        days.push_back(time_ns([&] ()
+        {
+            UserDictionary dictionary(directory, [] () {});
+            for (auto& word : words)
+                dictionary.learn(word);
+
+            dictionary.flush();
+            stats = dictionary.get_stats();
+        }));
+
+        year.appended_bytes += stats.appended_bytes;
+        year.compacted_bytes += stats.compacted_bytes;
+        year.compactions += stats.compactions;
+        year.compaction_ns += stats.compaction_ns;
+    }
+
+    auto file_kib = [&] (const std::string& name)
+    {
+        return std::filesystem::file_size(directory + "/" + name) / 1024.0;
+    };
+
+    double appended = std::max<uint64_t>(year.appended_bytes, 1);
+    results.add("user-dictionary-day", days, {
+        {"days", double(DAYS)},
+        {"words", double(DAYS * WORDS_PER_DAY)},
+        {"compactions", double(year.compactions)},
+        {"compaction_ms_total", year.compaction_ns / 1e6},
+        {"compaction_ms_mean", year.compaction_ns / 1e6 /
+            std::max<uint64_t>(year.compactions, 1)},
+        {"appended_kib", year.appended_bytes / 1024.0},
+        {"compacted_kib", year.compacted_bytes / 1024.0},
+        {"write_amplification", (year.appended_bytes + year.compacted_bytes) / appended},
+        {"log_kib", file_kib("learned-words.log")},
+        {"trie_kib", file_kib("learned-words.trie")},
+    });
+
+    std::filesystem::remove_all(directory);
+}
+
+/* A text of about 5000 characters, mostly ASCII with a few characters
+ * which go through keymap slots */
+static std::u32string get_bench_text()
+{
+    std::u32string text;
+    while (text.size() < 5000)
+        text += U"The quick brown fox jumps over the lazy dog, déjà vu! ";
+
+    return text;
+}
+
+static BenchResults::extra_t get_throughput(const std::vector<uint64_t>& samples,
+    size_t characters)
+{
+    double total = 0;
+    for (auto sample : samples)
+        total += sample;
+
+    double seconds = total / std::max<size_t>(samples.size(), 1) / 1e9;
+    return {{"characters", double(characters)},
+        {"chars_per_second", characters / seconds}};
+}
+
+/* VirtualKeyboardDevice::type_text(), until the compositor has every
+ * request. The stand-in compositor logs each request, so this is a lower
+ * bound of the throughput with a real one. */
+static void bench_type_text(BenchResults& results, int repetitions)
+{
+    auto text = get_bench_text();
+    auto display = wf::WaylandDisplay::get().display;
+    wf::repeat_config_t repeat;
+    repeat.rate = 0;
+
+    std::vector<uint64_t> samples;
+    wf::emission_stats_t stats;
+    for (int i = 0; i < repetitions; i++)
+    {
+        auto device = std::make_unique<wf::VirtualKeyboardDevice>(wf::get_text_keys(), repeat);
+        wl_display_roundtrip(display);
+        samples.push_back(time_ns([&] ()
+        {
+            device->type_text(text);
+            stats = device->get_stats();
+            device.reset();
+            wl_display_roundtrip(display);
+        }));
+    }
+
+    auto extra = get_throughput(samples, text.size());
+    extra.push_back({"requests_per_character", double(stats.requests) / text.size()});
+    extra.push_back({"keymap_uploads", double(stats.keymap_uploads)});
+    results.add("type-text", samples, extra);
+}
+
+/* wf-osk --type with a running keyboard: TextServer::send_text() from
+ * another thread, while the main loop serves it */
+static void bench_type_text_ipc(BenchResults& results, int repetitions)
+{
+    auto text = get_bench_text();
+    std::string utf8;
+    for (auto ch : text)
+        utf8 += Glib::ustring(1, gunichar(ch)).raw();
+
+    auto display = wf::WaylandDisplay::get().display;
+    TextServer server([&] (const std::string& text)
+    {
+        /* Destroying the device joins its writer thread, so that the
+         * timing includes the delivery of every request */
+        wf::repeat_config_t repeat;
+        repeat.rate = 0;
+        auto device = std::make_unique<wf::VirtualKeyboardDevice>(wf::get_text_keys(), repeat);
+        size_t missing = device->type_text(utf8_to_utf32(text));
+        device.reset();
+        wl_display_roundtrip(display);
+        return missing;
+    });
+
+    std::vector<uint64_t> samples;
+    auto context = Glib::MainContext::get_default();
+    for (int i = 0; i < repetitions; i++)
+    {
+        std::atomic<bool> done{false};
+        bool sent = false;
+        size_t missing = 0;
+        samples.push_back(time_ns([&] ()
+        {
+            std::thread client([&] ()
+            {
+                sent = TextServer::send_text(utf8, missing);
+                done = true;
+                context->wakeup();
+            });
+
+            while (!done)
+                context->iteration(true);
+
+            client.join();
+        }));
+
+        if (!sent || missing)
+        {
+            results.skip("type-text-ipc", "the keyboard did not type the text");
+            return;
+        }
+    }
+
+    results.add("type-text-ipc", samples, get_throughput(samples, text.size()));
+}
+
+int main(int argc, char **argv)
+{
+    int repetitions = (argc > 1) ? std::max(1, atoi(argv[1])) : 100;
+    BenchResults results;
+    /* The benchmarks without GTK still use glibmm main loop sources */
+    Glib::init();
+    bench_hit_test(results, repetitions);
+    bench_completion(results, repetitions);
+    bench_prediction(results, repetitions);
+    bench_user_dictionary(results);
+    bench_type_text(results, repetitions);
+    bench_type_text_ipc(results, repetitions);
+
+    /* The compositor only stands in for the virtual keyboard */
+    gdk_set_allowed_backends("x11,broadway");
+    Glib::RefPtr<Gtk::Application> app;
+    if (gtk_init_check(&argc, &argv))
+    {
+        app = Gtk::Application::create();
+        bench_layouts(results, repetitions);
+        bench_keyboard(results, repetitions);
+    } else
+    {
+        for (auto name : {"layout-build", "keyboard-create", "init-layouts",
+                "send-keymap", "switch"})
+        {
+            results.skip(name, "GTK cannot open a display");
+        }
+    }
+
+    results.print(std::cout);
+    return 0;
+}
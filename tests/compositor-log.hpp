@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* For the programs run by the stand-in compositor, see compositor.cpp */
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " \
+                << #condition << std::endl; \
+            std::exit(1); \
+        } \
+    } while (0)
+
+/* Exit code for tests which cannot run here, e.g. without a display */
+static constexpr int TEST_SKIPPED = 77;
+
+struct logged_request_t
+{
+    /* Time the compositor received it, since it started */
+    uint64_t ns;
+    /* e.g. vk1, the first virtual keyboard */
+    std::string object;
+    std::string request;
+    std::vector<uint64_t> args;
+};
+
+/**
+ * The requests the compositor received so far, only those to the object
+ * if one is given. A roundtrip makes sure that all requests sent before
+ * it are in the log.
+ */
+inline std::vector<logged_request_t> read_compositor_log(
+    const std::string& object = "")
+{
+    const char *path = getenv("WF_OSK_COMPOSITOR_LOG");
+    std::ifstream file(path ? path : "");
+    if (!file)
+    {
+        std::cerr << "No compositor log, run the test with wf-osk-test-compositor"
+            << std::endl;
+        std::exit(1);
+    }
+
+    std::vector<logged_request_t> requests;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        logged_request_t request;
+        fields >> request.ns >> request.object >> request.request;
+        for (uint64_t arg; fields >> arg;)
+            request.args.push_back(arg);
+
+        if (object.empty() || (request.object == object))
+            requests.push_back(std::move(request));
+    }
+
+    return requests;
+}
+
+/* The requests of the given kind among requests */
+inline std::vector<logged_request_t> filter_requests(
+    const std::vector<logged_request_t>& requests, const std::string& kind)
+{
+    std::vector<logged_request_t> result;
+    for (auto& request : requests)
+    {
+        if (request.request == kind)
+            result.push_back(request);
+    }
+
+    return result;
+}
@@ -0,0 +1,384 @@
+#include <virtual-keyboard-unstable-v1-server-protocol.h>
+#include <wayfire-shell-unstable-v2-server-protocol.h>
+#include <wayland-server.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <map>
+#include <string>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/**
+ * A headless compositor standing in for Wayfire in the tests and
+ * benchmarks. It announces two seats, zwp_virtual_keyboard_manager_v1
+ * and zwf_shell_manager_v2, runs the command line it is given as its
+ * client and exits with the status of the command.
+ *
+ * Every request to a virtual keyboard or a shell object is written to
+ * a log, one line per request:
+ *
+ *   <ns since start> <object> <request> <arguments...>
+ *
+ * e.g. "1520331 vk1 key 5231 30 1". Objects are named after their
+ * interface and numbered in creation order, seats by the order they
+ * are announced in. The log is flushed after every line, so a client
+ * finds all of its requests in it after a roundtrip. The path of the
+ * log is in $WF_OSK_COMPOSITOR_LOG, see compositor-log.hpp.
+ */
+
+static constexpr int SEATS = 2;
+
+static FILE *request_log;
+static uint64_t start_ns;
+static pid_t child = -1;
+static int child_status = 1;
+
+struct object_t
+{
+    std::string name;
+};
+
+static uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void log_request(wl_resource *resource, const char *request,
+    std::initializer_list<uint64_t> args = {})
+{
+    auto object = static_cast<object_t*>(wl_resource_get_user_data(resource));
+    fprintf(request_log, "%llu %s %s", (unsigned long long)(now_ns() - start_ns),
+        object->name.c_str(), request);
+    for (auto arg : args)
+        fprintf(request_log, " %llu", (unsigned long long)arg);
+
+    fputc('\n', request_log);
+    fflush(request_log);
+}
+
+static void destroy_object(wl_resource *resource)
+{
+    delete static_cast<object_t*>(wl_resource_get_user_data(resource));
+}
+
+/* A resource named after the interface, e.g. vk3 for the third one */
+static wl_resource *create_object(wl_client *client, const wl_interface *interface,
+    int version, uint32_t id, const void *implementation, const std::string& name)
+{
+    static std::map<std::string, int> counts;
+    auto resource = wl_resource_create(client, interface, version, id);
+    if (!resource)
+    {
+        wl_client_post_no_memory(client);
+        return nullptr;
+    }
+
+    auto object = new object_t{name + std::to_string(++counts[name])};
+    wl_resource_set_implementation(resource, implementation, object, destroy_object);
+    return resource;
+}
+
+static void destroy_request(wl_client *client, wl_resource *resource)
+{
+    log_request(resource, "destroy");
+    wl_resource_destroy(resource);
+}
+
+// zwp_virtual_keyboard_v1
+static void vk_keymap(wl_client *client, wl_resource *resource,
+    uint32_t format, int32_t fd, uint32_t size)
+{
+    /* Map it like a compositor would, the keymap is NUL terminated */
+    struct stat st = {};
+    bool valid = false;
+    if ((fstat(fd, &st) == 0) && (size > 0) && (uint64_t(st.st_size) >= size))
+    {
+        void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            auto text = (const char*)data;
+            valid = (text[size - 1] == '\0') &&
+                (strncmp(text, "xkb_keymap", strlen("xkb_keymap")) == 0);
+            munmap(data, size);
+        }
+    }
+
+    /* Keymaps sharing a file have the same inode */
+    log_request(resource, "keymap", {format, size, valid, st.st_ino});
+    close(fd);
+}
+
+static void vk_key(wl_client *client, wl_resource *resource,
+    uint32_t time, uint32_t key, uint32_t state)
+{
+    log_request(resource, "key", {time, key, state});
+}
+
+static void vk_modifiers(wl_client *client, wl_resource *resource,
+    uint32_t depressed, uint32_t latched, uint32_t locked, uint32_t group)
+{
+    log_request(resource, "modifiers", {depressed, latched, locked, group});
+}
+
+static const struct zwp_virtual_keyboard_v1_interface vk_implementation = {
+    vk_keymap,
+    vk_key,
+    vk_modifiers,
+    destroy_request,
+};
+
+// zwp_virtual_keyboard_manager_v1
+static void vk_manager_create(wl_client *client, wl_resource *resource,
+    wl_resource *seat, uint32_t id)
+{
+    auto vk = create_object(client, &zwp_virtual_keyboard_v1_interface,
+        wl_resource_get_version(resource), id, &vk_implementation, "vk");
+    if (vk)
+        log_request(vk, "create", {uint64_t(*(int*)wl_resource_get_user_data(seat))});
+}
+
+static const struct zwp_virtual_keyboard_manager_v1_interface vk_manager_implementation = {
+    vk_manager_create,
+};
+
+static void bind_vk_manager(wl_client *client, void *data,
+    uint32_t version, uint32_t id)
+{
+    create_object(client, &zwp_virtual_keyboard_manager_v1_interface, version, id,
+        &vk_manager_implementation, "vk_manager");
+}
+
+// zwf_shell_manager_v2 and its objects
+static void output_inhibit(wl_client *client, wl_resource *resource)
+{
+    log_request(resource, "inhibit_output");
+}
+
+static void output_inhibit_done(wl_client *client, wl_resource *resource)
+{
+    log_request(resource, "inhibit_output_done");
+}
+
+static void output_create_hotspot(wl_client *client, wl_resource *resource,
+    uint32_t hotspot, uint32_t threshold, uint32_t timeout, uint32_t id)
+{
+    /* The hotspot is never entered */
+    auto created = create_object(client, &zwf_hotspot_v2_interface,
+        wl_resource_get_version(resource), id, nullptr, "wf_hotspot");
+    if (created)
+        log_request(resource, "create_hotspot", {hotspot, threshold, timeout});
+}
+
+static const struct zwf_output_v2_interface wf_output_implementation = {
+    output_inhibit,
+    output_inhibit_done,
+    output_create_hotspot,
+};
+
+static void surface_interactive_move(wl_client *client, wl_resource *resource)
+{
+    log_request(resource, "interactive_move");
+}
+
+static const struct zwf_surface_v2_interface wf_surface_implementation = {
+    surface_interactive_move,
+};
+
+static void shell_get_wf_output(wl_client *client, wl_resource *resource,
+    wl_resource *output, uint32_t id)
+{
+    auto created = create_object(client, &zwf_output_v2_interface,
+        wl_resource_get_version(resource), id, &wf_output_implementation, "wf_output");
+    if (created)
+        log_request(created, "create");
+}
+
+static void shell_get_wf_surface(wl_client *client, wl_resource *resource,
+    wl_resource *surface, uint32_t id)
+{
+    auto created = create_object(client, &zwf_surface_v2_interface,
+        wl_resource_get_version(resource), id, &wf_surface_implementation, "wf_surface");
+    if (created)
+        log_request(created, "create");
+}
+
+static const struct zwf_shell_manager_v2_interface shell_implementation = {
+    shell_get_wf_output,
+    shell_get_wf_surface,
+};
+
+static void bind_shell(wl_client *client, void *data, uint32_t version, uint32_t id)
+{
+    create_object(client, &zwf_shell_manager_v2_interface, version, id,
+        &shell_implementation, "shell");
+}
+
+// wl_seat, with inert input devices
+static void seat_get_device(wl_client *client, wl_resource *resource,
+    const wl_interface *interface, uint32_t id)
+{
+    auto device = wl_resource_create(client, interface,
+        wl_resource_get_version(resource), id);
+    if (!device)
+        wl_client_post_no_memory(client);
+}
+
+static void seat_get_pointer(wl_client *client, wl_resource *resource, uint32_t id)
+{
+    seat_get_device(client, resource, &wl_pointer_interface, id);
+}
+
+static void seat_get_keyboard(wl_client *client, wl_resource *resource, uint32_t id)
+{
+    seat_get_device(client, resource, &wl_keyboard_interface, id);
+}
+
+static void seat_get_touch(wl_client *client, wl_resource *resource, uint32_t id)
+{
+    seat_get_device(client, resource, &wl_touch_interface, id);
+}
+
+static const struct wl_seat_interface seat_implementation = {
+    seat_get_pointer,
+    seat_get_keyboard,
+    seat_get_touch,
+    nullptr,
+};
+
+static void bind_seat(wl_client *client, void *data, uint32_t version, uint32_t id)
+{
+    /* The user data is the number of the seat */
+    auto resource = wl_resource_create(client, &wl_seat_interface, version, id);
+    if (!resource)
+        return wl_client_post_no_memory(client);
+
+    wl_resource_set_implementation(resource, &seat_implementation, data, nullptr);
+    wl_seat_send_capabilities(resource, WL_SEAT_CAPABILITY_KEYBOARD);
+}
+
+static int on_child_exit(int signal, void *data)
+{
+    int status;
+    if (waitpid(child, &status, WNOHANG) != child)
+        return 0;
+
+    if (WIFEXITED(status))
+    {
+        child_status = WEXITSTATUS(status);
+    } else
+    {
+        std::cerr << "The client was killed by signal " << WTERMSIG(status) << std::endl;
+        child_status = 1;
+    }
+
+    wl_display_terminate(static_cast<wl_display*>(data));
+    return 0;
+}
+
+/* Do not leave the client behind when the test times out */
+static int on_terminate(int signal, void *data)
+{
+    kill(child, SIGTERM);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <command> [arguments...]" << std::endl;
+        return 1;
+    }
+
+    /* Test runners may not provide a session */
+    std::string runtime_dir = getenv("XDG_RUNTIME_DIR") ? getenv("XDG_RUNTIME_DIR") : "";
+    if (runtime_dir.empty())
+    {
+        char path[] = "/tmp/wf-osk-test-XXXXXX";
+        if (!mkdtemp(path))
+        {
+            perror("mkdtemp");
+            return 1;
+        }
+
+        runtime_dir = path;
+        setenv("XDG_RUNTIME_DIR", path, 1);
+    }
+
+    wl_display *display = wl_display_create();
+    const char *socket = display ? wl_display_add_socket_auto(display) : nullptr;
+    if (!socket)
+    {
+        std::cerr << "Failed to create a wayland socket in " << runtime_dir << std::endl;
+        return 1;
+    }
+
+    std::string log_path = getenv("WF_OSK_COMPOSITOR_LOG") ?
+        getenv("WF_OSK_COMPOSITOR_LOG") : runtime_dir + "/" + socket + ".log";
+    request_log = fopen(log_path.c_str(), "we");
+    if (!request_log)
+    {
+        perror(log_path.c_str());
+        return 1;
+    }
+
+    setenv("WAYLAND_DISPLAY", socket, 1);
+    setenv("WF_OSK_COMPOSITOR_LOG", log_path.c_str(), 1);
+
+    static int seat_numbers[SEATS];
+    for (int i = 0; i < SEATS; i++)
+    {
+        seat_numbers[i] = i + 1;
+        wl_global_create(display, &wl_seat_interface, 1, &seat_numbers[i], bind_seat);
+    }
+
+    wl_global_create(display, &zwp_virtual_keyboard_manager_v1_interface, 1,
+        nullptr, bind_vk_manager);
+    wl_global_create(display, &zwf_shell_manager_v2_interface, 1,
+        nullptr, bind_shell);
+
+    /* The signals are blocked from now on and read from a signalfd */
+    auto loop = wl_display_get_event_loop(display);
+    wl_event_loop_add_signal(loop, SIGCHLD, on_child_exit, display);
+    wl_event_loop_add_signal(loop, SIGTERM, on_terminate, nullptr);
+    wl_event_loop_add_signal(loop, SIGINT, on_terminate, nullptr);
+
+    start_ns = now_ns();
+    child = fork();
+    if (child < 0)
+    {
+        perror("fork");
+        return 1;
+    }
+
+    if (child == 0)
+    {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGCHLD);
+        sigaddset(&signals, SIGTERM);
+        sigaddset(&signals, SIGINT);
+        sigprocmask(SIG_UNBLOCK, &signals, nullptr);
+
+        execvp(argv[1], argv + 1);
+        perror(argv[1]);
+        _exit(127);
+    }
+
+    wl_display_run(display);
+    wl_display_destroy_clients(display);
+    wl_display_destroy(display);
+    fclose(request_log);
+
+    return child_status;
+}
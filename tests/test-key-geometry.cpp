@@ -0,0 +1,71 @@
+#include "compositor-log.hpp"
+#include "osk.hpp"
+
+#include <cmath>
+
+/* Checks that the canvas lays out the keys of the built-in layouts like
+ * the buttons of KeyboardLayout, so that both show the same keyboard.
+ * Skipped when GTK cannot open a display. */
+
+using namespace wf::osk;
+
+static void check_layout(const LayoutTable& table, int width, int height)
+{
+    std::vector<double> key_widths;
+    std::vector<size_t> row_sizes;
+    for (auto& row : table)
+    {
+        for (auto& key : row)
+            key_widths.push_back(key.width);
+
+        row_sizes.push_back(row.size());
+    }
+
+    KeyGeometry geometry;
+    geometry.update(key_widths, row_sizes, width, height, spacing);
+
+    KeyboardLayout layout(table, width, height);
+    CHECK(layout.rows.size() == row_sizes.size());
+    size_t i = 0;
+    for (auto& row : layout.rows)
+    {
+        /* Buttons truncate their size, keys round their edges */
+        int row_width = 0;
+        for (auto& key : row->keys)
+        {
+            int button_width, button_height;
+            key->button.get_size_request(button_width, button_height);
+            CHECK(std::abs(geometry.width[i] - button_width) <= 1);
+            CHECK(std::abs(geometry.height[i] - button_height) <= 1);
+            row_width += button_width;
+            ++i;
+        }
+
+        row_width += (row->keys.size() - 1) * spacing;
+        CHECK((row_width <= width) && (row_width > width - int(row->keys.size())));
+    }
+
+    CHECK(i == geometry.size());
+}
+
+int main(int argc, char **argv)
+{
+    gdk_set_allowed_backends("x11,broadway");
+    if (!gtk_init_check(&argc, &argv))
+    {
+        std::cerr << "GTK cannot open a display, skipping" << std::endl;
+        return TEST_SKIPPED;
+    }
+
+    auto app = Gtk::Application::create();
+
+    for (int id = 0; id < LAYOUT_COUNT; id++)
+    {
+        auto& table = get_builtin_layout(layout_id_t(id));
+        check_layout(table, default_width, default_height);
+        check_layout(table, 1366, 300);
+        check_layout(table, 360, 240);
+    }
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "compositor-log.hpp"
+#include "virtual-keyboard.hpp"
+#include "wayland-window.hpp"
+#include "keymap.hpp"
+
+#include <dirent.h>
+#include <linux/input-event-codes.h>
+
+/* Uploading keymaps again and again, for new devices and for remapped
+ * slots, must not leave file descriptors or mappings behind. Run by
+ * wf-osk-test-compositor. */
+
+static constexpr int ROUNDS = 200;
+
+static size_t count_fds()
+{
+    size_t count = 0;
+    DIR *dir = opendir("/proc/self/fd");
+    CHECK(dir);
+    while (readdir(dir))
+        count++;
+
+    closedir(dir);
+    return count;
+}
+
+static size_t count_mappings()
+{
+    std::ifstream maps("/proc/self/maps");
+    size_t count = 0;
+    for (std::string line; std::getline(maps, line);)
+        count++;
+
+    return count;
+}
+
+/* Two key sets, as for switching between the letters and the numbers */
+static std::set<uint32_t> get_keys(int round)
+{
+    if (round % 2)
+        return {KEY_1, KEY_2, KEY_3, KEY_4, KEY_5, KEY_MINUS, KEY_EQUAL};
+
+    return {KEY_Q, KEY_W, KEY_E, KEY_R, KEY_T, KEY_Y, KEY_SPACE};
+}
+
+/* A device typing more characters than there are slots, so the keymap
+ * is uploaded several times */
+static void run_round(int round)
+{
+    std::u32string text;
+    for (int i = 0; i < 3 * wf::KEYMAP_SLOTS; i++)
+        text += char32_t(0x3b1 + (round + i) % 40);
+
+    wf::repeat_config_t repeat;
+    repeat.rate = 0;
+    {
+        wf::VirtualKeyboardDevice device(get_keys(round), repeat);
+        CHECK(device.type_text(text) == 0);
+        CHECK(device.get_stats().keymap_uploads >= 2);
+    }
+
+    /* libwayland closes its copies of the fds once they are sent */
+    wl_display_roundtrip(wf::WaylandDisplay::get().display);
+}
+
+int main(int argc, char **argv)
+{
+    /* Thread stacks, malloc arenas and the connection are set up by the
+     * first rounds */
+    for (int round = 0; round < 4; round++)
+        run_round(round);
+
+    size_t fds = count_fds();
+    size_t mappings = count_mappings();
+    for (int round = 0; round < ROUNDS; round++)
+        run_round(round);
+
+    std::cout << "fds: " << fds << " -> " << count_fds()
+        << ", mappings: " << mappings << " -> " << count_mappings() << std::endl;
+    CHECK(count_fds() == fds);
+    CHECK(count_mappings() == mappings);
+
+    /* Every keymap reached the compositor intact */
+    auto keymaps = filter_requests(read_compositor_log(), "keymap");
+    CHECK(keymaps.size() >= 3 * (ROUNDS + 4));
+    for (auto& keymap : keymaps)
+        CHECK(keymap.args[2] == 1);
+
+    /* Devices with the same keys share the keymap file */
+    {
+        wf::repeat_config_t repeat;
+        wf::VirtualKeyboardDevice first(get_keys(0), repeat);
+        wf::VirtualKeyboardDevice second(get_keys(0), repeat);
+    }
+
+    wl_display_roundtrip(wf::WaylandDisplay::get().display);
+    keymaps = filter_requests(read_compositor_log(), "keymap");
+    size_t last = keymaps.size() - 1;
+    CHECK(keymaps[last].object != keymaps[last - 1].object);
+    CHECK(keymaps[last].args[3] == keymaps[last - 1].args[3]);
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "compositor-log.hpp"
+#include "osk.hpp"
+
+#include <random>
+
+/* Replays a trace of overlapping touches on a KeyboardCanvas and checks
+ * that the compositor gets exactly the key events the touches stand for,
+ * none dropped or doubled. Run by wf-osk-test-compositor, skipped when GTK
+ * cannot open a display. */
+
+using namespace wf::osk;
+
+static constexpr int FINGERS = 3;
+static constexpr int STEPS = 5000;
+
+/* Touch events go straight to the handler, the canvas is never shown */
+struct TraceCanvas : public KeyboardCanvas
+{
+    using KeyboardCanvas::KeyboardCanvas;
+    using KeyboardCanvas::on_touch_event;
+};
+
+struct touch_t
+{
+    GdkEventType type;
+    int finger;
+    double x, y;
+};
+
+struct typing_key_t
+{
+    uint32_t code;
+    double x, y;
+    double width, height;
+};
+
+/* The keys of the layout which type, with their position on the canvas */
+static std::vector<typing_key_t> get_typing_keys(const LayoutTable& table)
+{
+    std::vector<double> key_widths;
+    std::vector<size_t> row_sizes;
+    std::vector<uint32_t> codes;
+    for (auto& row : table)
+    {
+        for (auto& key : row)
+        {
+            key_widths.push_back(key.width);
+            codes.push_back(key.code);
+        }
+
+        row_sizes.push_back(row.size());
+    }
+
+    KeyGeometry geometry;
+    geometry.update(key_widths, row_sizes, default_width, default_height, spacing);
+
+    std::vector<typing_key_t> keys;
+    for (size_t i = 0; i < codes.size(); i++)
+    {
+        if ((codes[i] != 0) && (codes[i] < USE_SHIFT) &&
+            !IS_COMMAND(codes[i]) && !IS_MODIFIER(codes[i]))
+        {
+            keys.push_back({codes[i], geometry.x[i], geometry.y[i],
+                geometry.width[i], geometry.height[i]});
+        }
+    }
+
+    return keys;
+}
+
+/**
+ * A rolling trace of up to FINGERS touches: fingers land on random keys,
+ * often on a key another finger holds, move a little within their key
+ * and lift or are cancelled in any order.
+ */
+static std::vector<touch_t> make_trace(const std::vector<typing_key_t>& keys)
+{
+    std::mt19937 random(4);
+    std::uniform_real_distribution<double> inside(0.2, 0.8);
+    int held[FINGERS];
+    std::fill(held, held + FINGERS, -1);
+
+    std::vector<touch_t> trace;
+    auto point_in = [&] (int key, GdkEventType type, int finger)
+    {
+        auto& k = keys[key];
+        trace.push_back({type, finger, k.x + inside(random) * k.width,
+            k.y + inside(random) * k.height});
+    };
+
+    for (int step = 0; step < STEPS; step++)
+    {
+        int finger = random() % FINGERS;
+        if (held[finger] < 0)
+        {
+            int other = held[random() % FINGERS];
+            held[finger] = ((other >= 0) && (random() % 3 == 0)) ?
+                other : int(random() % keys.size());
+            point_in(held[finger], GDK_TOUCH_BEGIN, finger);
+        } else if (random() % 4 == 0)
+        {
+            point_in(held[finger], GDK_TOUCH_UPDATE, finger);
+        } else
+        {
+            auto& k = keys[held[finger]];
+            trace.push_back({(random() % 10) ? GDK_TOUCH_END : GDK_TOUCH_CANCEL,
+                finger, k.x + 1, k.y + 1});
+            held[finger] = -1;
+        }
+    }
+
+    for (int finger = 0; finger < FINGERS; finger++)
+    {
+        if (held[finger] >= 0)
+            point_in(held[finger], GDK_TOUCH_END, finger);
+    }
+
+    return trace;
+}
+
+/* The key events of the trace: a finger landing on a held key lifts it
+ * first, only the last finger up releases a key */
+static std::vector<std::pair<uint64_t, uint64_t>> get_expected_keys(
+    const std::vector<touch_t>& trace, const std::vector<typing_key_t>& keys)
+{
+    std::vector<std::pair<uint64_t, uint64_t>> expected;
+    std::map<uint32_t, int> held;
+    uint32_t finger_code[FINGERS] = {0};
+    for (auto& touch : trace)
+    {
+        if (touch.type == GDK_TOUCH_BEGIN)
+        {
+            for (auto& key : keys)
+            {
+                if ((touch.x >= key.x) && (touch.x < key.x + key.width) &&
+                    (touch.y >= key.y) && (touch.y < key.y + key.height))
+                {
+                    finger_code[touch.finger] = key.code;
+                }
+            }
+
+            uint32_t code = finger_code[touch.finger];
+            if (held[code]++ > 0)
+                expected.push_back({code, WL_KEYBOARD_KEY_STATE_RELEASED});
+
+            expected.push_back({code, WL_KEYBOARD_KEY_STATE_PRESSED});
+        } else if (touch.type != GDK_TOUCH_UPDATE)
+        {
+            uint32_t code = finger_code[touch.finger];
+            if (--held[code] == 0)
+                expected.push_back({code, WL_KEYBOARD_KEY_STATE_RELEASED});
+        }
+    }
+
+    return expected;
+}
+
+int main(int argc, char **argv)
+{
+    /* The compositor only stands in for the virtual keyboard */
+    gdk_set_allowed_backends("x11,broadway");
+    if (!gtk_init_check(&argc, &argv))
+    {
+        std::cerr << "GTK cannot open a display, skipping" << std::endl;
+        return TEST_SKIPPED;
+    }
+
+    auto app = Gtk::Application::create();
+    Keyboard::create();
+
+    auto& table = get_builtin_layout(LAYOUT_DEFAULT);
+    auto keys = get_typing_keys(table);
+    CHECK(!keys.empty());
+    auto trace = make_trace(keys);
+    auto expected = get_expected_keys(trace, keys);
+    {
+        TraceCanvas canvas(table, default_width, default_height);
+        for (auto& touch : trace)
+        {
+            GdkEventTouch event = {};
+            event.type = touch.type;
+            event.x = touch.x;
+            event.y = touch.y;
+            event.sequence = (GdkEventSequence*)uintptr_t(touch.finger + 1);
+            canvas.on_touch_event(&event);
+        }
+
+        auto& stats = canvas.get_stats();
+        CHECK(stats.max_presses == FINGERS);
+        std::cout << "damaged per key event: " << 100.0 * stats.damaged_pixels /
+            stats.key_events / stats.surface_pixels << "% of the surface" << std::endl;
+    }
+
+    /* Destroying the keyboard joins its writer thread */
+    Keyboard::destroy();
+    wl_display_roundtrip(wf::WaylandDisplay::get().display);
+
+    auto logged = filter_requests(read_compositor_log("vk1"), "key");
+    std::cout << trace.size() << " touch events, " << expected.size()
+        << " key events expected, " << logged.size() << " received" << std::endl;
+    CHECK(logged.size() == expected.size());
+    for (size_t i = 0; i < logged.size(); i++)
+    {
+        CHECK(logged[i].args[1] == expected[i].first);
+        CHECK(logged[i].args[2] == expected[i].second);
+    }
+
+    return 0;
+}
@@ -0,0 +1,244 @@
+#include "compositor-log.hpp"
+#include "virtual-keyboard.hpp"
+#include "wayland-window.hpp"
+#include "keymap.hpp"
+
+#include <linux/input-event-codes.h>
+
+/* Checks what VirtualKeyboardDevice sends, run by wf-osk-test-compositor.
+ * Every test creates its own device, which is vk1, vk2 and so on in the
+ * log of the compositor. */
+
+static std::unique_ptr<wf::VirtualKeyboardDevice> create_device(
+    const std::set<uint32_t>& keys)
+{
+    wf::repeat_config_t repeat;
+    repeat.rate = 0;
+    return std::make_unique<wf::VirtualKeyboardDevice>(keys, repeat);
+}
+
+/* Destroy the device and wait until the compositor has all its requests */
+static std::vector<logged_request_t> finish(
+    std::unique_ptr<wf::VirtualKeyboardDevice>& device, const std::string& object)
+{
+    device.reset();
+    wl_display_roundtrip(wf::WaylandDisplay::get().display);
+    return read_compositor_log(object);
+}
+
+/* Presses and releases pair up, in order */
+static void check_keys_balanced(const std::vector<logged_request_t>& requests)
+{
+    std::map<uint64_t, int> held;
+    uint64_t last_time = 0;
+    for (auto& key : filter_requests(requests, "key"))
+    {
+        CHECK(key.args[0] >= last_time);
+        last_time = key.args[0];
+
+        int& count = held[key.args[1]];
+        count += (key.args[2] == WL_KEYBOARD_KEY_STATE_PRESSED) ? 1 : -1;
+        CHECK((count == 0) || (count == 1));
+    }
+
+    for (auto& [key, count] : held)
+        CHECK(count == 0);
+}
+
+static void test_keys()
+{
+    auto device = create_device({KEY_A, KEY_B});
+    device->send_key(KEY_A, WL_KEYBOARD_KEY_STATE_PRESSED);
+    device->send_key(KEY_A, WL_KEYBOARD_KEY_STATE_RELEASED);
+    device->flush();
+    device->send_key(KEY_B, WL_KEYBOARD_KEY_STATE_PRESSED);
+    device->send_key(KEY_B, WL_KEYBOARD_KEY_STATE_RELEASED);
+    device->flush();
+
+    auto requests = finish(device, "vk1");
+    CHECK(requests.size() == 7);
+
+    /* Without GDK, the first seat is used */
+    CHECK(requests[0].request == "create");
+    CHECK(requests[0].args[0] == 1);
+
+    CHECK(requests[1].request == "keymap");
+    CHECK(requests[1].args[0] == WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1);
+    CHECK(requests[1].args[2] == 1);
+
+    uint64_t expected[4][2] = {
+        {KEY_A, WL_KEYBOARD_KEY_STATE_PRESSED},
+        {KEY_A, WL_KEYBOARD_KEY_STATE_RELEASED},
+        {KEY_B, WL_KEYBOARD_KEY_STATE_PRESSED},
+        {KEY_B, WL_KEYBOARD_KEY_STATE_RELEASED},
+    };
+
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(requests[i + 2].request == "key");
+        CHECK(requests[i + 2].args[1] == expected[i][0]);
+        CHECK(requests[i + 2].args[2] == expected[i][1]);
+    }
+
+    check_keys_balanced(requests);
+    CHECK(requests.back().request == "destroy");
+}
+
+static void test_shifted_run()
+{
+    /* A run of shifted symbols holds shift once, not once per key */
+    auto device = create_device(wf::get_text_keys());
+    CHECK(device->type_text(U"!@#$%") == 0);
+
+    auto requests = finish(device, "vk2");
+    auto modifiers = filter_requests(requests, "modifiers");
+    CHECK(modifiers.size() == 2);
+    CHECK(modifiers[0].args[0] == wf::MODIFIER_SHIFT);
+    CHECK(modifiers[1].args[0] == 0);
+
+    auto keys = filter_requests(requests, "key");
+    CHECK(keys.size() == 10);
+    CHECK(modifiers[0].ns <= keys.front().ns);
+    CHECK(modifiers[1].ns >= keys.back().ns);
+    check_keys_balanced(requests);
+}
+
+static void test_latched_modifier()
+{
+    auto device = create_device(wf::get_text_keys());
+    device->tap_modifier(wf::MODIFIER_CTRL);
+    device->send_key(KEY_C, WL_KEYBOARD_KEY_STATE_PRESSED);
+    device->send_key(KEY_C, WL_KEYBOARD_KEY_STATE_RELEASED);
+    device->flush();
+    CHECK(device->get_modifiers() == 0);
+
+    auto requests = finish(device, "vk3");
+    auto modifiers = filter_requests(requests, "modifiers");
+    CHECK(!modifiers.empty());
+    CHECK(modifiers[0].args[1] == wf::MODIFIER_CTRL);
+    CHECK(modifiers[0].ns <= filter_requests(requests, "key")[0].ns);
+}
+
+static void test_type_text()
+{
+    /* Characters outside of the keymap go through slots, with one more
+     * keymap for all of them */
+    auto device = create_device(wf::get_text_keys());
+    CHECK(device->type_text(U"Héllo wörld ✓") == 0);
+    CHECK(device->get_stats().keymap_uploads == 1);
+
+    auto requests = finish(device, "vk4");
+    auto keymaps = filter_requests(requests, "keymap");
+    CHECK(keymaps.size() == 2);
+    for (auto& keymap : keymaps)
+        CHECK(keymap.args[2] == 1);
+
+    auto keys = filter_requests(requests, "key");
+    CHECK(keys.size() == 2 * 13);
+    check_keys_balanced(requests);
+    CHECK(requests.back().request == "destroy");
+}
+
+static void test_type_text_modifiers()
+{
+    /* Text is typed without the latched Ctrl, which stays latched for
+     * the next key, as when autocorrect types before the key */
+    auto device = create_device(wf::get_text_keys());
+    device->tap_modifier(wf::MODIFIER_CTRL);
+    CHECK(device->type_text(U"ab") == 0);
+    CHECK(device->get_modifiers() == wf::MODIFIER_CTRL);
+    device->send_key(KEY_C, WL_KEYBOARD_KEY_STATE_PRESSED);
+    device->send_key(KEY_C, WL_KEYBOARD_KEY_STATE_RELEASED);
+    device->flush();
+
+    auto requests = finish(device, "vk5");
+    auto modifiers = filter_requests(requests, "modifiers");
+    auto keys = filter_requests(requests, "key");
+    CHECK(modifiers.size() == 3);
+    CHECK(keys.size() == 6);
+    CHECK(modifiers[1].args[1] == 0);
+    CHECK((modifiers[1].ns <= keys[0].ns) && (modifiers[2].ns >= keys[3].ns));
+    CHECK(modifiers[2].args[1] == wf::MODIFIER_CTRL);
+    CHECK(modifiers[2].ns <= keys[4].ns);
+    CHECK(keys[4].args[1] == KEY_C);
+}
+
+static void test_modifiers_changed()
+{
+    /* The keys of the keyboard follow the latch, up to its release */
+    auto device = create_device(wf::get_text_keys());
+    int changes = 0;
+    device->set_modifiers_changed([&] () { changes++; });
+
+    device->tap_modifier(wf::MODIFIER_ALT);
+    CHECK((changes == 1) && (device->get_latched_modifiers() == wf::MODIFIER_ALT));
+    device->tap_modifier(wf::MODIFIER_ALT);
+    CHECK((changes == 2) && (device->get_locked_modifiers() == wf::MODIFIER_ALT));
+    device->tap_modifier(wf::MODIFIER_ALT);
+    device->tap_modifier(wf::MODIFIER_CTRL);
+    CHECK(changes == 4);
+
+    /* Typed text neither consumes nor reports the latch */
+    device->type_text(U"x");
+    CHECK((changes == 4) && (device->get_latched_modifiers() == wf::MODIFIER_CTRL));
+    device->send_key(KEY_C, WL_KEYBOARD_KEY_STATE_PRESSED);
+    device->send_key(KEY_C, WL_KEYBOARD_KEY_STATE_RELEASED);
+    CHECK((changes == 5) && (device->get_latched_modifiers() == 0));
+    finish(device, "vk6");
+}
+
+static void test_keymap_resets_modifiers()
+{
+    /* Uppercase letters between more slot characters than there are
+     * slots, so the text needs a second keymap while shift is in use */
+    std::u32string text;
+    for (int i = 0; i < wf::KEYMAP_SLOTS + 8; i++)
+    {
+        text += char32_t(U'A' + i);
+        text += char32_t(0x3b1 + i);
+    }
+
+    auto device = create_device(wf::get_text_keys());
+    CHECK(device->type_text(text) == 0);
+    CHECK(device->get_stats().keymap_uploads == 2);
+
+    /* Each keymap resets the modifiers of the compositor, a modifiers
+     * request has to come before the next key */
+    auto requests = finish(device, "vk7");
+    uint32_t depressed = 0;
+    bool keymap_pending = false;
+    size_t pressed = 0;
+    for (auto& request : requests)
+    {
+        if (request.request == "keymap")
+        {
+            depressed = 0;
+            keymap_pending = (pressed > 0);
+        } else if (request.request == "modifiers")
+        {
+            depressed = request.args[0];
+            keymap_pending = false;
+        } else if ((request.request == "key") &&
+            (request.args[2] == WL_KEYBOARD_KEY_STATE_PRESSED))
+        {
+            CHECK(!keymap_pending);
+            bool upper = (text[pressed] >= U'A') && (text[pressed] <= U'Z');
+            CHECK(bool(depressed & wf::MODIFIER_SHIFT) == upper);
+            pressed++;
+        }
+    }
+
+    CHECK(pressed == text.size());
+}
+
+int main(int argc, char **argv)
+{
+    test_keys();
+    test_shifted_run();
+    test_latched_modifier();
+    test_type_text();
+    test_type_text_modifiers();
+    test_modifiers_changed();
+    test_keymap_resets_modifiers();
+    return 0;
+}